@@ -0,0 +1,230 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+/**
+* Cost of preparing one atomic commit, the way a request can be built each frame:
+* looking every property id up by name again, allocating a fresh request with
+* cached ids, reusing one request but re-adding the whole state, and rolling a
+* request back with drmModeAtomicSetCursor() to add only FB_ID and the damage.
+* Nothing is committed. Pass a card (e.g. /dev/dri/card0) to time the by-name
+* lookups against its real objects, without one only the cached paths run.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+
+#define MIN_SECONDS 0.3
+#define BATCH 256
+
+typedef enum _prep {
+  PREP_LOOKUP = 0,
+  PREP_REBUILD,
+  PREP_REFILL,
+  PREP_CURSOR,
+  PREP_MAX
+} prep;
+
+static const char *prep_names[PREP_MAX] = {
+  "lookup by name, new request",
+  "cached ids, new request",
+  "cached ids, whole state again",
+  "cached ids, cursor + FB_ID"
+};
+
+/* What a full commit of one Connector -> CRTC -> Plane chain carries */
+typedef enum _state_prop {
+  CONN_CRTC_ID = 0,
+  CRTC_MODE_ID,
+  CRTC_ACTIVE,
+  PLANE_FB_ID,
+  PLANE_CRTC_ID,
+  PLANE_SRC_X,
+  PLANE_SRC_Y,
+  PLANE_SRC_W,
+  PLANE_SRC_H,
+  PLANE_CRTC_X,
+  PLANE_CRTC_Y,
+  PLANE_CRTC_W,
+  PLANE_CRTC_H,
+  PLANE_DAMAGE_CLIPS,
+  STATE_PROP_MAX
+} state_prop;
+
+static const struct { const char *name; uint32_t obj_type; } state_props[STATE_PROP_MAX] = {
+  { "CRTC_ID", DRM_MODE_OBJECT_CONNECTOR }, { "MODE_ID", DRM_MODE_OBJECT_CRTC }, { "ACTIVE", DRM_MODE_OBJECT_CRTC },
+  { "FB_ID", DRM_MODE_OBJECT_PLANE }, { "CRTC_ID", DRM_MODE_OBJECT_PLANE },
+  { "SRC_X", DRM_MODE_OBJECT_PLANE }, { "SRC_Y", DRM_MODE_OBJECT_PLANE }, { "SRC_W", DRM_MODE_OBJECT_PLANE }, { "SRC_H", DRM_MODE_OBJECT_PLANE },
+  { "CRTC_X", DRM_MODE_OBJECT_PLANE }, { "CRTC_Y", DRM_MODE_OBJECT_PLANE }, { "CRTC_W", DRM_MODE_OBJECT_PLANE }, { "CRTC_H", DRM_MODE_OBJECT_PLANE },
+  { "FB_DAMAGE_CLIPS", DRM_MODE_OBJECT_PLANE }
+};
+
+typedef struct _chain {
+  int fd;
+  uint32_t conn_id;
+  uint32_t crtc_id;
+  uint32_t plane_id;
+  uint32_t props[STATE_PROP_MAX];
+} chain;
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t object_id(const chain *ch, uint32_t obj_type) {
+  if (obj_type == DRM_MODE_OBJECT_CONNECTOR) return ch->conn_id;
+  if (obj_type == DRM_MODE_OBJECT_CRTC) return ch->crtc_id;
+  return ch->plane_id;
+}
+
+/* The per frame lookup a request built from scratch would do */
+static uint32_t lookup_prop(int fd, uint32_t obj_id, uint32_t obj_type, const char *name) {
+  uint32_t id = 0;
+
+  drmModeObjectProperties *props = drmModeObjectGetProperties(fd, obj_id, obj_type);
+  if (!props) return 0;
+
+  for (uint32_t i = 0; i < props->count_props && !id; i++) {
+    drmModePropertyRes *prop = drmModeGetProperty(fd, props->props[i]);
+    if (!prop) continue;
+    if (!strcmp(prop->name, name)) id = prop->prop_id;
+    drmModeFreeProperty(prop);
+  }
+
+  drmModeFreeObjectProperties(props);
+  return id;
+}
+
+/* First connector, CRTC and plane the card has, only their property ids matter here */
+static bool open_chain(chain *ch, const char *card) {
+  ch->fd = open(card, O_RDWR | O_CLOEXEC);
+  if (ch->fd < 0) { fprintf(stderr, "[x] open: %s: %s\n", card, strerror(errno)); return false; }
+
+  drmSetClientCap(ch->fd, DRM_CLIENT_CAP_UNIVERSAL_PLANES, 1);
+  drmSetClientCap(ch->fd, DRM_CLIENT_CAP_ATOMIC, 1);
+
+  drmModeRes *res = drmModeGetResources(ch->fd);
+  drmModePlaneRes *planes = drmModeGetPlaneResources(ch->fd);
+  bool ok = res && planes && res->count_connectors && res->count_crtcs && planes->count_planes;
+  if (ok) {
+    ch->conn_id = res->connectors[0];
+    ch->crtc_id = res->crtcs[0];
+    ch->plane_id = planes->planes[0];
+  } else {
+    fprintf(stderr, "[x] %s has no KMS objects to look properties up on\n", card);
+  }
+
+  if (planes) drmModeFreePlaneResources(planes);
+  if (res) drmModeFreeResources(res);
+  if (!ok) { close(ch->fd); ch->fd = -1; return false; }
+
+  for (uint32_t p = 0; p < STATE_PROP_MAX; p++)
+    ch->props[p] = lookup_prop(ch->fd, object_id(ch, state_props[p].obj_type), state_props[p].obj_type, state_props[p].name);
+
+  return true;
+}
+
+static void add_state(drmModeAtomicReq *req, const chain *ch, const uint32_t *props, uint64_t fb_id) {
+  const uint64_t values[STATE_PROP_MAX] = { ch->crtc_id, 1, 1, fb_id, ch->crtc_id, 0, 0, 1920 << 16, 1080 << 16, 0, 0, 1920, 1080, 0 };
+
+  for (uint32_t p = 0; p < PLANE_DAMAGE_CLIPS; p++)
+    drmModeAtomicAddProperty(req, object_id(ch, state_props[p].obj_type), props[p], values[p]);
+}
+
+static void run(prep kind, drmModeAtomicReq *req, int base, const chain *ch, uint64_t fb_id) {
+  uint32_t props[STATE_PROP_MAX];
+
+  switch (kind) {
+    case PREP_LOOKUP:
+      for (uint32_t p = 0; p < STATE_PROP_MAX; p++)
+        props[p] = lookup_prop(ch->fd, object_id(ch, state_props[p].obj_type), state_props[p].obj_type, state_props[p].name);
+      req = drmModeAtomicAlloc();
+      add_state(req, ch, props, fb_id);
+      drmModeAtomicFree(req);
+      break;
+    case PREP_REBUILD:
+      req = drmModeAtomicAlloc();
+      add_state(req, ch, ch->props, fb_id);
+      drmModeAtomicFree(req);
+      break;
+    case PREP_REFILL:
+      drmModeAtomicSetCursor(req, base);
+      add_state(req, ch, ch->props, fb_id);
+      break;
+    case PREP_CURSOR:
+      drmModeAtomicSetCursor(req, base);
+      drmModeAtomicAddProperty(req, ch->plane_id, ch->props[PLANE_FB_ID], fb_id);
+      drmModeAtomicAddProperty(req, ch->plane_id, ch->props[PLANE_DAMAGE_CLIPS], 1);
+      break;
+    default: break;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  /* Made up ids are fine as long as nothing gets committed */
+  chain ch = { .fd = -1, .conn_id = 51, .crtc_id = 41, .plane_id = 31 };
+  for (uint32_t p = 0; p < STATE_PROP_MAX; p++)
+    ch.props[p] = p + 1;
+
+  if (argc > 1 && !open_chain(&ch, argv[1])) return EXIT_FAILURE;
+
+  drmModeAtomicReq *req = drmModeAtomicAlloc();
+  if (!req) { fprintf(stderr, "[x] drmModeAtomicAlloc: %s\n", strerror(errno)); return EXIT_FAILURE; }
+  int base = drmModeAtomicGetCursor(req);
+
+  printf("%-32s %12s %10s\n", "commit preparation", "frames/s", "ns/frame");
+
+  for (prep kind = PREP_LOOKUP; kind < PREP_MAX; kind++) {
+    if (kind == PREP_LOOKUP && ch.fd < 0) {
+      printf("%-32s %12s %10s\n", prep_names[kind], "-", "no card");
+      continue;
+    }
+
+    uint64_t frames = 0;
+    double start = now(), elapsed = 0;
+    /* A batch per clock read, a single preparation takes less time than reading the clock */
+    do {
+      for (uint32_t i = 0; i < BATCH; i++, frames++)
+        run(kind, req, base, &ch, 100 + (frames & 1));
+      elapsed = now() - start;
+    } while (elapsed < MIN_SECONDS);
+
+    printf("%-32s %12.0f %10.1f\n", prep_names[kind], frames / elapsed, elapsed / frames * 1e9);
+  }
+
+  drmModeAtomicFree(req);
+  if (ch.fd >= 0) close(ch.fd);
+  return EXIT_SUCCESS;
+}
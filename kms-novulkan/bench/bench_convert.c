@@ -0,0 +1,125 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+/* Compares every SIMD conversion kernel with the scalar reference, for speed and for identical output */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include "convert.h"
+
+#define MIN_SECONDS 0.3
+#define WIDTH 3840
+#define HEIGHT 2160
+
+typedef enum _conversion {
+  RGBA_TO_XRGB8888 = 0,
+  RGB_TO_XRGB8888,
+  RGBA_TO_RGB565,
+  RGBA_TO_ARGB8888_PREMUL,
+  CONVERSION_MAX
+} conversion;
+
+static const struct { const char *name; uint32_t src_bpp, dst_bpp; } conversions[CONVERSION_MAX] = {
+  { "rgba->xrgb8888", 4, 4 },
+  { "rgb->xrgb8888", 3, 4 },
+  { "rgba->rgb565", 4, 2 },
+  { "rgba->argb8888 premul", 4, 4 }
+};
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void run(conversion conv, void *dst, const uint8_t *src, uint32_t count) {
+  switch (conv) {
+    case RGBA_TO_XRGB8888: convert_rgba_to_xrgb8888(dst, src, count); break;
+    case RGB_TO_XRGB8888: convert_rgb_to_xrgb8888(dst, src, count); break;
+    case RGBA_TO_RGB565: convert_rgba_to_rgb565(dst, src, count); break;
+    case RGBA_TO_ARGB8888_PREMUL: convert_rgba_to_argb8888_premul(dst, src, count); break;
+    default: break;
+  }
+}
+
+int main(void) {
+  /* Odd pixel count so every kernel also has to run its tail */
+  uint32_t count = WIDTH * HEIGHT - 3;
+  uint8_t *src = malloc((size_t) count * 4);
+  uint8_t *ref = malloc((size_t) count * 4);
+  uint8_t *dst = malloc((size_t) count * 4);
+  int ret = EXIT_FAILURE;
+
+  if (!src || !ref || !dst) { fprintf(stderr, "[x] malloc: %s\n", strerror(errno)); goto exit_bench; }
+
+  srand(1);
+  for (size_t i = 0; i < (size_t) count * 4; i++) src[i] = rand();
+
+  printf("%d x %d pixels\n", WIDTH, HEIGHT);
+  printf("%-22s %-7s %10s %8s\n", "conversion", "kernel", "Mpix/s", "speedup");
+
+  for (conversion conv = 0; conv < CONVERSION_MAX; conv++) {
+    size_t dst_bytes = (size_t) count * conversions[conv].dst_bpp;
+    double scalar_rate = 0;
+
+    convert_set_kernel(CONVERT_KERNEL_SCALAR);
+    run(conv, ref, src, count);
+
+    for (convert_kernel k = CONVERT_KERNEL_SCALAR; k < CONVERT_KERNEL_MAX; k++) {
+      if (!convert_set_kernel(k)) continue;
+
+      memset(dst, 0, dst_bytes);
+      run(conv, dst, src, count);
+      if (memcmp(dst, ref, dst_bytes)) {
+        fprintf(stderr, "[x] %s %s output differs from the scalar reference\n", conversions[conv].name, convert_kernel_name(k));
+        goto exit_bench;
+      }
+
+      uint32_t iters = 0;
+      double start = now(), elapsed = 0;
+      do {
+        run(conv, dst, src, count);
+        iters++;
+        elapsed = now() - start;
+      } while (elapsed < MIN_SECONDS);
+
+      double rate = (double) count * iters / elapsed / 1e6;
+      if (k == CONVERT_KERNEL_SCALAR) scalar_rate = rate;
+      printf("%-22s %-7s %10.1f %7.2fx\n", conversions[conv].name, convert_kernel_name(k), rate, rate / scalar_rate);
+    }
+  }
+
+  ret = EXIT_SUCCESS;
+
+exit_bench:
+  free(dst);
+  free(ref);
+  free(src);
+  return ret;
+}
@@ -0,0 +1,88 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+/* Measures the throughput of every fill kernel the CPU supports at common display resolutions */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include "fill.h"
+
+#define MIN_SECONDS 0.5
+
+static const struct { const char *name; uint32_t width, height; } resolutions[] = {
+  { "1080p", 1920, 1080 },
+  { "1440p", 2560, 1440 },
+  { "4K",    3840, 2160 }
+};
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(void) {
+  printf("%-8s %-7s %10s %10s\n", "kernel", "mode", "frames/s", "GB/s");
+
+  for (size_t r = 0; r < sizeof(resolutions) / sizeof(resolutions[0]); r++) {
+    uint32_t width = resolutions[r].width, height = resolutions[r].height;
+    /* Scanout BOs usually have their pitch aligned to 256 bytes */
+    uint32_t pitch = (width * 4 + 255) & ~255u;
+    size_t bytes = (size_t) pitch * height;
+
+    uint8_t *fb = aligned_alloc(4096, bytes);
+    if (!fb) { fprintf(stderr, "[x] aligned_alloc: %s\n", strerror(errno)); return EXIT_FAILURE; }
+    memset(fb, 0, bytes);
+
+    for (fill_kernel k = FILL_KERNEL_SCALAR; k < FILL_KERNEL_MAX; k++) {
+      if (!fill_set_kernel(k)) continue;
+
+      uint32_t frames = 0;
+      double start = now(), elapsed = 0;
+      do {
+        fill_rect32(fb, pitch, width, height, 0x00102030 + frames);
+        frames++;
+        elapsed = now() - start;
+      } while (elapsed < MIN_SECONDS);
+
+      if (*(uint32_t *) &fb[pitch * (height - 1) + (width - 1) * 4] != 0x00102030 + frames - 1) {
+        fprintf(stderr, "[x] %s kernel produced a wrong pixel\n", fill_kernel_name(k));
+        free(fb);
+        return EXIT_FAILURE;
+      }
+
+      double gbps = (double) width * 4 * height * frames / elapsed / 1e9;
+      printf("%-8s %-7s %10.1f %10.2f\n", fill_kernel_name(k), resolutions[r].name, frames / elapsed, gbps);
+    }
+
+    free(fb);
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,93 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+/* Reports how a banded fill scales from one thread up to every online CPU */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "fill.h"
+#include "fillpool.h"
+
+#define MIN_SECONDS 0.5
+
+static const struct { const char *name; uint32_t width, height; } resolutions[] = {
+  { "4K", 3840, 2160 },
+  { "8K", 7680, 4320 }
+};
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[]) {
+  long online = sysconf(_SC_NPROCESSORS_ONLN);
+  uint32_t max_threads = (argc > 1) ? (uint32_t) strtoul(argv[1], NULL, 10) : (uint32_t) (online > 0 ? online : 1);
+  if (!max_threads) max_threads = 1;
+
+  printf("fill kernel: %s\n", fill_kernel_name(fill_get_kernel()));
+  printf("%-5s %7s %10s %10s %8s\n", "mode", "threads", "frames/s", "GB/s", "speedup");
+
+  for (size_t r = 0; r < sizeof(resolutions) / sizeof(resolutions[0]); r++) {
+    uint32_t width = resolutions[r].width, height = resolutions[r].height;
+    uint32_t pitch = (width * 4 + 255) & ~255u;
+    size_t bytes = (size_t) pitch * height;
+    double base_fps = 0;
+
+    uint8_t *fb = aligned_alloc(4096, bytes);
+    if (!fb) { fprintf(stderr, "[x] aligned_alloc: %s\n", strerror(errno)); return EXIT_FAILURE; }
+    memset(fb, 0, bytes);
+
+    for (uint32_t threads = 1; threads <= max_threads; threads++) {
+      fill_pool *pool = fill_pool_create(threads);
+      if (!pool) { free(fb); return EXIT_FAILURE; }
+
+      uint32_t frames = 0;
+      double start = now(), elapsed = 0;
+      do {
+        fill_pool_rect32(pool, fb, pitch, width, height, 0x00405060 + frames);
+        frames++;
+        elapsed = now() - start;
+      } while (elapsed < MIN_SECONDS);
+
+      fill_pool_destroy(pool);
+
+      double fps = frames / elapsed;
+      if (threads == 1) base_fps = fps;
+      printf("%-5s %7u %10.1f %10.2f %7.2fx\n", resolutions[r].name, threads, fps,
+             (double) width * 4 * height * fps / 1e9, fps / base_fps);
+    }
+
+    free(fb);
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,258 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+/**
+* Fill and upload throughput of the two framebuffer backends the kms examples have:
+* GBM BOs written with gbm_bo_write() (a frame composed in cached staging memory,
+* then copied into the BO) and dumb buffers written in place through their mapping,
+* with ordinary and with non-temporal stores. Pass a card (e.g. /dev/dri/card0) to
+* write real BOs and real write-combined dumb mappings, without one the targets are
+* plain heap memory and only the CPU side of each path is measured.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#include <xf86drm.h>
+#include <gbm.h>
+
+#include "fill.h"
+
+#define MIN_SECONDS 0.5
+
+static const struct { const char *name; uint32_t width, height; } resolutions[] = {
+  { "1080p", 1920, 1080 },
+  { "4K",    3840, 2160 }
+};
+
+typedef enum _path {
+  PATH_GBM_WRITE = 0,
+  PATH_DUMB,
+  PATH_DUMB_NT,
+  PATH_MAX
+} path;
+
+static const char *path_names[PATH_MAX] = {
+  "gbm write", "dumb", "dumb + nt"
+};
+
+typedef enum _op {
+  OP_FILL = 0,
+  OP_UPLOAD,
+  OP_MAX
+} op;
+
+static const char *op_names[OP_MAX] = {
+  "fill", "upload"
+};
+
+/* Everything one resolution writes into and out of */
+typedef struct _targets {
+  uint32_t width, height;
+  uint32_t pitch; /* Of the staging and source frames, matches the BO when there is one */
+  uint8_t *staging; /* Where the gbm path composes a frame */
+  uint8_t *frame; /* Finished frame the upload op copies out of */
+  struct gbm_bo *bo; /* NULL without a card, the gbm path then copies into dumb */
+  uint32_t dumb_handle;
+  uint32_t dumb_pitch;
+  uint64_t dumb_size;
+  uint8_t *dumb; /* Dumb buffer mapping, or heap memory without a card */
+} targets;
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static bool create_dumb(targets *t, int fd) {
+  struct drm_mode_create_dumb create = { .width = t->width, .height = t->height, .bpp = 32 };
+  struct drm_mode_map_dumb map = { 0 };
+
+  if (drmIoctl(fd, DRM_IOCTL_MODE_CREATE_DUMB, &create) < 0) {
+    fprintf(stderr, "[x] DRM_IOCTL_MODE_CREATE_DUMB: %s\n", strerror(errno));
+    return false;
+  }
+
+  t->dumb_handle = create.handle;
+  t->dumb_pitch = create.pitch;
+  t->dumb_size = create.size;
+
+  map.handle = create.handle;
+  if (drmIoctl(fd, DRM_IOCTL_MODE_MAP_DUMB, &map) < 0) {
+    fprintf(stderr, "[x] DRM_IOCTL_MODE_MAP_DUMB: %s\n", strerror(errno));
+    return false;
+  }
+
+  t->dumb = mmap(NULL, t->dumb_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, map.offset);
+  if (t->dumb == MAP_FAILED) {
+    fprintf(stderr, "[x] mmap: %s\n", strerror(errno));
+    t->dumb = NULL;
+    return false;
+  }
+
+  return true;
+}
+
+static bool create_targets(targets *t, int fd, struct gbm_device *gbm, uint32_t width, uint32_t height) {
+  memset(t, 0, sizeof(targets));
+  t->width = width;
+  t->height = height;
+  /* Scanout BOs usually have their pitch aligned to 256 bytes */
+  t->pitch = (width * 4 + 255) & ~255u;
+
+  if (gbm) {
+    /* Mesa backs GBM_BO_USE_WRITE BOs with a dumb buffer and gbm_bo_write() is a memcpy into its mapping */
+    t->bo = gbm_bo_create(gbm, width, height, GBM_FORMAT_XRGB8888, GBM_BO_USE_SCANOUT | GBM_BO_USE_WRITE);
+    if (!t->bo) fprintf(stderr, "[x] gbm_bo_create: %s, skipping the gbm path\n", strerror(errno));
+    else t->pitch = gbm_bo_get_stride(t->bo);
+  }
+
+  if (fd >= 0) {
+    if (!create_dumb(t, fd)) return false;
+  } else {
+    t->dumb_pitch = t->pitch;
+    t->dumb_size = (uint64_t) t->pitch * height;
+    t->dumb = aligned_alloc(4096, t->dumb_size);
+    if (!t->dumb) { fprintf(stderr, "[x] aligned_alloc: %s\n", strerror(errno)); return false; }
+  }
+
+  t->staging = aligned_alloc(4096, (size_t) t->pitch * height);
+  t->frame = aligned_alloc(4096, (size_t) t->pitch * height);
+  if (!t->staging || !t->frame) { fprintf(stderr, "[x] aligned_alloc: %s\n", strerror(errno)); return false; }
+
+  memset(t->staging, 0, (size_t) t->pitch * height);
+  memset(t->dumb, 0, t->dumb_size);
+  fill_rect32(t->frame, t->pitch, width, height, 0x00405060);
+
+  return true;
+}
+
+static void destroy_targets(targets *t, int fd) {
+  if (t->bo) gbm_bo_destroy(t->bo);
+
+  if (fd >= 0) {
+    if (t->dumb) munmap(t->dumb, t->dumb_size);
+    if (t->dumb_handle) {
+      struct drm_mode_destroy_dumb destroy = { .handle = t->dumb_handle };
+      drmIoctl(fd, DRM_IOCTL_MODE_DESTROY_DUMB, &destroy);
+    }
+  } else {
+    free(t->dumb);
+  }
+
+  free(t->staging);
+  free(t->frame);
+}
+
+/* The gbm path without a card ends in a plain copy, like gbm_bo_write() does */
+static void write_bo(targets *t, const uint8_t *src) {
+  if (t->bo) gbm_bo_write(t->bo, src, (size_t) t->pitch * t->height);
+  else memcpy(t->dumb, src, (size_t) t->pitch * t->height);
+}
+
+static void run(path kind, op what, targets *t, uint32_t pixel) {
+  switch (kind) {
+    case PATH_GBM_WRITE:
+      if (what == OP_FILL) fill_rect32(t->staging, t->pitch, t->width, t->height, pixel);
+      write_bo(t, (what == OP_FILL) ? t->staging : t->frame);
+      break;
+    default:
+      /* Whether the stores stream depends only on the kernel picked for the path */
+      if (what == OP_FILL) fill_rect32(t->dumb, t->dumb_pitch, t->width, t->height, pixel);
+      else fill_copy_rows(t->dumb, t->dumb_pitch, t->frame, t->pitch, t->width * 4, t->height);
+      break;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  struct gbm_device *gbm = NULL;
+  int fd = -1, ret = EXIT_SUCCESS;
+
+  if (argc > 1) {
+    fd = open(argv[1], O_RDWR | O_CLOEXEC);
+    if (fd < 0) { fprintf(stderr, "[x] open: %s: %s\n", argv[1], strerror(errno)); return EXIT_FAILURE; }
+    gbm = gbm_create_device(fd);
+    if (!gbm) fprintf(stderr, "[x] gbm_create_device: %s, skipping the gbm path\n", strerror(errno));
+  }
+
+  fill_kernel stream = fill_stream_kernel();
+  printf("%-10s %-7s %-7s %-8s %10s %10s\n", "backend", "op", "mode", "kernel", "frames/s", "GB/s");
+
+  for (size_t r = 0; r < sizeof(resolutions) / sizeof(resolutions[0]) && ret == EXIT_SUCCESS; r++) {
+    targets t;
+    if (!create_targets(&t, fd, gbm, resolutions[r].width, resolutions[r].height)) {
+      destroy_targets(&t, fd);
+      ret = EXIT_FAILURE;
+      break;
+    }
+
+    for (path kind = PATH_GBM_WRITE; kind < PATH_MAX; kind++) {
+      if (kind == PATH_GBM_WRITE && fd >= 0 && !t.bo) continue;
+      if (kind == PATH_DUMB_NT && stream == FILL_KERNEL_AUTO) {
+        printf("%-10s %-7s %-7s %-8s %10s %10s\n", path_names[kind], "-", resolutions[r].name, "-", "-", "no nt");
+        continue;
+      }
+
+      fill_set_kernel((kind == PATH_DUMB_NT) ? stream : FILL_KERNEL_AUTO);
+
+      for (op what = OP_FILL; what < OP_MAX; what++) {
+        uint32_t frames = 0;
+        double start = now(), elapsed = 0;
+        do {
+          run(kind, what, &t, 0x00102030 + frames);
+          frames++;
+          elapsed = now() - start;
+        } while (elapsed < MIN_SECONDS);
+
+        /* One read of the last pixel, dumb mappings are uncached so nothing more */
+        uint32_t expect = (what == OP_FILL) ? 0x00102030 + frames - 1 : 0x00405060;
+        bool check = kind != PATH_GBM_WRITE || !t.bo;
+        if (check && *(uint32_t *) &t.dumb[(size_t) t.dumb_pitch * (t.height - 1) + (t.width - 1) * 4] != expect) {
+          fprintf(stderr, "[x] %s %s produced a wrong pixel\n", path_names[kind], op_names[what]);
+          ret = EXIT_FAILURE;
+          break;
+        }
+
+        double gbps = (double) t.width * 4 * t.height * frames / elapsed / 1e9;
+        printf("%-10s %-7s %-7s %-8s %10.1f %10.2f\n", path_names[kind], op_names[what], resolutions[r].name,
+               fill_kernel_name(fill_get_kernel()), frames / elapsed, gbps);
+      }
+    }
+
+    destroy_targets(&t, fd);
+  }
+
+  if (gbm) gbm_device_destroy(gbm);
+  if (fd >= 0) close(fd);
+  return ret;
+}
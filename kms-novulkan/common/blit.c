@@ -0,0 +1,366 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BLIT_HAVE_X86
+#include <immintrin.h>
+#endif
+
+#include "fill.h"
+#include "blit.h"
+
+/* Bilinear weights use 7 fractional bits so (b - a) * w always fits a signed 16 bit lane */
+#define WEIGHT_BITS 7
+#define WEIGHT_ONE (1 << WEIGHT_BITS)
+
+typedef struct _blit_rect {
+  uint32_t x, y, w, h;
+} blit_rect;
+
+/* Per destination column source index and weight, computed once per blit */
+typedef struct _blit_tap {
+  uint32_t idx;
+  uint32_t weight;
+} blit_tap;
+
+static const char *fit_names[BLIT_FIT_MAX] = { "center", "contain", "cover", "stretch" };
+static const char *filter_names[BLIT_FILTER_MAX] = { "nearest", "bilinear" };
+
+blit_fit blit_fit_from_name(const char *name) {
+  for (uint32_t i = 0; i < BLIT_FIT_MAX; i++)
+    if (!strcmp(name, fit_names[i])) return (blit_fit) i;
+  return BLIT_FIT_MAX;
+}
+
+blit_filter blit_filter_from_name(const char *name) {
+  for (uint32_t i = 0; i < BLIT_FILTER_MAX; i++)
+    if (!strcmp(name, filter_names[i])) return (blit_filter) i;
+  return BLIT_FILTER_MAX;
+}
+
+/**
+* Work out which part of the source lands on which part of the destination.
+* Scaling keeps the aspect ratio for contain/cover, computed in 64 bit so
+* large panoramas can't overflow.
+*/
+static void place(const blit_surface *dst, const blit_surface *src, blit_fit fit, blit_rect *dr, blit_rect *sr) {
+  uint64_t sw = src->width, sh = src->height, dw = dst->width, dh = dst->height;
+  bool src_wider = sw * dh > dw * sh;
+
+  *sr = (blit_rect) { 0, 0, src->width, src->height };
+  *dr = (blit_rect) { 0, 0, dst->width, dst->height };
+
+  switch (fit) {
+    case BLIT_FIT_CENTER:
+      if (sw > dw) { sr->x = (sw - dw) / 2; sr->w = dw; }
+      else { dr->x = (dw - sw) / 2; dr->w = sw; }
+      if (sh > dh) { sr->y = (sh - dh) / 2; sr->h = dh; }
+      else { dr->y = (dh - sh) / 2; dr->h = sh; }
+      break;
+    case BLIT_FIT_CONTAIN:
+      if (src_wider) { dr->h = (sh * dw) / sw; dr->y = (dh - dr->h) / 2; }
+      else { dr->w = (sw * dh) / sh; dr->x = (dw - dr->w) / 2; }
+      break;
+    case BLIT_FIT_COVER:
+      if (src_wider) { sr->w = (dw * sh) / dh; sr->x = (sw - sr->w) / 2; }
+      else { sr->h = (dh * sw) / dw; sr->y = (sh - sr->h) / 2; }
+      break;
+    default: break;
+  }
+
+  if (!dr->w) dr->w = 1;
+  if (!dr->h) dr->h = 1;
+  if (!sr->w) sr->w = 1;
+  if (!sr->h) sr->h = 1;
+}
+
+/**
+* Map destination samples onto source samples (pixel centers line up).
+* For bilinear the index is the left/top tap and is clamped so idx + 1 is
+* always readable, which lets the SIMD path use a single 8 byte load.
+*/
+static void build_taps(blit_tap *taps, uint32_t dst_len, uint32_t src_off, uint32_t src_len, uint32_t src_total, blit_filter filter) {
+  for (uint32_t i = 0; i < dst_len; i++) {
+    /* 16.16 fixed point source coordinate of the destination pixel center */
+    int64_t pos = (((int64_t) i * 2 + 1) * src_len * 65536) / ((int64_t) dst_len * 2) + (int64_t) src_off * 65536;
+
+    if (filter == BLIT_FILTER_NEAREST) {
+      int64_t idx = pos >> 16;
+      if (idx >= src_total) idx = src_total - 1;
+      taps[i] = (blit_tap) { (uint32_t) idx, 0 };
+      continue;
+    }
+
+    pos -= 32768;
+    if (pos < 0) pos = 0;
+
+    int64_t idx = pos >> 16;
+    uint32_t weight = (uint32_t) ((pos & 0xffff) >> (16 - WEIGHT_BITS));
+    if (idx >= (int64_t) src_total - 1) { idx = src_total - 2; weight = WEIGHT_ONE; }
+
+    taps[i] = (blit_tap) { (uint32_t) idx, weight };
+  }
+}
+
+static void nearest_row_scalar(uint32_t *dst, const uint32_t *src, const blit_tap *xtaps, uint32_t width) {
+  for (uint32_t i = 0; i < width; i++)
+    dst[i] = src[xtaps[i].idx];
+}
+
+static inline uint32_t lerp_pixel(uint32_t a, uint32_t b, uint32_t w) {
+  uint32_t out = 0;
+  for (uint32_t c = 0; c < 32; c += 8) {
+    int32_t ca = (a >> c) & 0xff, cb = (b >> c) & 0xff;
+    out |= (uint32_t) (ca + (((cb - ca) * (int32_t) w) >> WEIGHT_BITS)) << c;
+  }
+  return out;
+}
+
+static void bilinear_row_scalar(uint32_t *dst, const uint32_t *row0, const uint32_t *row1, const blit_tap *xtaps, uint32_t width, uint32_t wy) {
+  for (uint32_t i = 0; i < width; i++) {
+    const blit_tap *t = &xtaps[i];
+    uint32_t left = lerp_pixel(row0[t->idx], row1[t->idx], wy);
+    uint32_t right = lerp_pixel(row0[t->idx + 1], row1[t->idx + 1], wy);
+    dst[i] = lerp_pixel(left, right, t->weight);
+  }
+}
+
+#ifdef BLIT_HAVE_X86
+__attribute__((target("avx2")))
+static void nearest_row_avx2(uint32_t *dst, const uint32_t *src, const blit_tap *xtaps, uint32_t width) {
+  uint32_t i = 0;
+
+  for (; i + 8 <= width; i += 8) {
+    __m256i idx = _mm256_setr_epi32(xtaps[i].idx, xtaps[i+1].idx, xtaps[i+2].idx, xtaps[i+3].idx,
+                                    xtaps[i+4].idx, xtaps[i+5].idx, xtaps[i+6].idx, xtaps[i+7].idx);
+    _mm256_storeu_si256((__m256i *) &dst[i], _mm256_i32gather_epi32((const int *) src, idx, 4));
+  }
+
+  nearest_row_scalar(dst + i, src, xtaps + i, width - i);
+}
+
+/* One destination pixel per iteration, all four channels interpolated at once in 16 bit lanes */
+__attribute__((target("sse2")))
+static void bilinear_row_sse2(uint32_t *dst, const uint32_t *row0, const uint32_t *row1, const blit_tap *xtaps, uint32_t width, uint32_t wy) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i vy = _mm_set1_epi16((short) wy);
+
+  for (uint32_t i = 0; i < width; i++) {
+    const blit_tap *t = &xtaps[i];
+
+    /* [left right] from both rows, widened to 16 bits per channel */
+    __m128i top = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) &row0[t->idx]), zero);
+    __m128i bot = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) &row1[t->idx]), zero);
+
+    __m128i v = _mm_add_epi16(top, _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(bot, top), vy), WEIGHT_BITS));
+
+    __m128i right = _mm_srli_si128(v, 8);
+    __m128i vx = _mm_set1_epi16((short) t->weight);
+    __m128i h = _mm_add_epi16(v, _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(right, v), vx), WEIGHT_BITS));
+
+    dst[i] = (uint32_t) _mm_cvtsi128_si32(_mm_packus_epi16(h, zero));
+  }
+}
+#endif
+
+typedef void (*nearest_row_fn)(uint32_t *, const uint32_t *, const blit_tap *, uint32_t);
+typedef void (*bilinear_row_fn)(uint32_t *, const uint32_t *, const uint32_t *, const blit_tap *, uint32_t, uint32_t);
+
+typedef struct _blit_plan {
+  blit_rect dr;
+  blit_rect sr;
+  blit_filter filter;
+  blit_tap *xtaps;
+  blit_tap *ytaps;
+  nearest_row_fn nearest_row;
+  bilinear_row_fn bilinear_row;
+} blit_plan;
+
+struct _blit_stream {
+  blit_surface dst;
+  blit_plan plan;
+  uint32_t src_width;
+  uint32_t next_src; /* Rows have to arrive in order, this is the one expected next */
+  uint32_t next_dst; /* First destination row (relative to plan.dr) not written yet */
+  uint32_t *ring[2]; /* The last two source rows, all bilinear ever needs */
+};
+
+static void fill_borders(const blit_surface *dst, const blit_rect *dr, uint32_t background) {
+  uint32_t below = dr->y + dr->h, right = dr->x + dr->w;
+
+  fill_rect32(dst->pixels, dst->pitch, dst->width, dr->y, background);
+  fill_rect32(dst->pixels + (size_t) dst->pitch * below, dst->pitch, dst->width, dst->height - below, background);
+
+  uint8_t *band = dst->pixels + (size_t) dst->pitch * dr->y;
+  fill_rect32(band, dst->pitch, dr->x, dr->h, background);
+  fill_rect32(band + (size_t) right * 4, dst->pitch, dst->width - right, dr->h, background);
+}
+
+/* Placement, taps and row kernels for one source -> destination pair. Also fills the borders */
+static bool plan_create(blit_plan *plan, const blit_surface *dst, uint32_t src_width, uint32_t src_height, blit_fit fit, blit_filter filter, uint32_t background) {
+  blit_surface src = { NULL, src_width, src_height, 0 };
+
+  memset(plan, 0, sizeof(blit_plan));
+  if (!dst->width || !dst->height || !src_width || !src_height) return false;
+
+  place(dst, &src, (fit < BLIT_FIT_MAX) ? fit : BLIT_FIT_CONTAIN, &plan->dr, &plan->sr);
+  fill_borders(dst, &plan->dr, background);
+
+  /* Single pixel wide sources have no right hand tap, those fall back to nearest */
+  plan->filter = (src_width < 2 || src_height < 2) ? BLIT_FILTER_NEAREST : filter;
+
+  /* Same size on both sides, nothing to resample */
+  if (plan->dr.w == plan->sr.w && plan->dr.h == plan->sr.h) return true;
+
+  plan->xtaps = malloc(sizeof(blit_tap) * (plan->dr.w + plan->dr.h));
+  if (!plan->xtaps) { fprintf(stderr, "[x] malloc: %s\n", strerror(errno)); return false; }
+  plan->ytaps = plan->xtaps + plan->dr.w;
+
+  build_taps(plan->xtaps, plan->dr.w, plan->sr.x, plan->sr.w, src_width, plan->filter);
+  build_taps(plan->ytaps, plan->dr.h, plan->sr.y, plan->sr.h, src_height, plan->filter);
+
+  plan->nearest_row = nearest_row_scalar;
+  plan->bilinear_row = bilinear_row_scalar;
+#ifdef BLIT_HAVE_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) plan->nearest_row = nearest_row_avx2;
+  if (__builtin_cpu_supports("sse2")) plan->bilinear_row = bilinear_row_sse2;
+#endif
+
+  return true;
+}
+
+static void plan_destroy(blit_plan *plan) {
+  free(plan->xtaps);
+  plan->xtaps = plan->ytaps = NULL;
+}
+
+static inline uint32_t *dst_row(const blit_surface *dst, const blit_plan *plan, uint32_t j) {
+  return (uint32_t *) (dst->pixels + (size_t) dst->pitch * (plan->dr.y + j)) + plan->dr.x;
+}
+
+/* row1 is only read by the bilinear filter and must be the source row after row0 */
+static void plan_resample(const blit_plan *plan, uint32_t *out, uint32_t j, const uint32_t *row0, const uint32_t *row1) {
+  if (plan->filter == BLIT_FILTER_NEAREST)
+    plan->nearest_row(out, row0, plan->xtaps, plan->dr.w);
+  else
+    plan->bilinear_row(out, row0, row1, plan->xtaps, plan->dr.w, plan->ytaps[j].weight);
+}
+
+bool blit_image32(const blit_surface *dst, const blit_surface *src, blit_fit fit, blit_filter filter, uint32_t background) {
+  blit_plan plan;
+
+  if (!plan_create(&plan, dst, src->width, src->height, fit, filter, background)) return false;
+
+  for (uint32_t j = 0; j < plan.dr.h; j++) {
+    uint32_t *out = dst_row(dst, &plan, j);
+
+    if (!plan.xtaps) {
+      memcpy(out, src->pixels + (size_t) src->pitch * (plan.sr.y + j) + (size_t) plan.sr.x * 4, (size_t) plan.dr.w * 4);
+      continue;
+    }
+
+    const uint32_t *row0 = (const uint32_t *) (src->pixels + (size_t) src->pitch * plan.ytaps[j].idx);
+    plan_resample(&plan, out, j, row0, (const uint32_t *) ((const uint8_t *) row0 + src->pitch));
+  }
+
+  plan_destroy(&plan);
+  return true;
+}
+
+blit_stream *blit_stream_create(const blit_surface *dst, uint32_t src_width, uint32_t src_height, blit_fit fit, blit_filter filter, uint32_t background) {
+  blit_stream *stream = calloc(1, sizeof(blit_stream));
+  if (!stream) { fprintf(stderr, "[x] calloc: %s\n", strerror(errno)); return NULL; }
+
+  stream->dst = *dst;
+  stream->src_width = src_width;
+
+  if (!plan_create(&stream->plan, dst, src_width, src_height, fit, filter, background)) goto err_destroy;
+
+  if (stream->plan.xtaps) {
+    stream->ring[0] = malloc(sizeof(uint32_t) * src_width * 2);
+    if (!stream->ring[0]) { fprintf(stderr, "[x] malloc: %s\n", strerror(errno)); goto err_destroy; }
+    stream->ring[1] = stream->ring[0] + src_width;
+  }
+
+  return stream;
+
+err_destroy:
+  blit_stream_destroy(stream);
+  return NULL;
+}
+
+void blit_stream_destroy(blit_stream *stream) {
+  if (!stream) return;
+  plan_destroy(&stream->plan);
+  free(stream->ring[0]);
+  free(stream);
+}
+
+bool blit_stream_row(blit_stream *stream, uint32_t y, const uint32_t *row) {
+  blit_plan *plan = &stream->plan;
+
+  if (y != stream->next_src) return false;
+  stream->next_src++;
+
+  if (stream->next_dst >= plan->dr.h) return true;
+
+  if (!plan->xtaps) {
+    if (y < plan->sr.y) return true;
+    memcpy(dst_row(&stream->dst, plan, stream->next_dst++), row + plan->sr.x, (size_t) plan->dr.w * 4);
+    return true;
+  }
+
+  /* Taps only move forward, rows before the next one referenced are never needed */
+  if (y < plan->ytaps[stream->next_dst].idx) return true;
+  memcpy(stream->ring[y & 1], row, sizeof(uint32_t) * stream->src_width);
+
+  /**
+  * Emit every destination row whose taps are now available. Anything that
+  * needed an earlier row went out when that row arrived, so the ones left
+  * need exactly this row (nearest) or the previous one and this one (bilinear).
+  */
+  while (stream->next_dst < plan->dr.h) {
+    uint32_t idx = plan->ytaps[stream->next_dst].idx;
+    uint32_t last = idx + (plan->filter == BLIT_FILTER_BILINEAR);
+    if (last > y) break;
+
+    plan_resample(plan, dst_row(&stream->dst, plan, stream->next_dst), stream->next_dst,
+                  stream->ring[idx & 1], stream->ring[(idx + 1) & 1]);
+    stream->next_dst++;
+  }
+
+  return true;
+}
+
+bool blit_stream_done(const blit_stream *stream) {
+  return stream->next_dst >= stream->plan.dr.h;
+}
@@ -0,0 +1,81 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#ifndef BLIT_H
+#define BLIT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+* Places a decoded 32 bit per pixel image into a framebuffer of any size.
+* Both sides carry their own pitch so the destination can be a scanout BO
+* with driver padding. Pixels are copied as is, any channel swizzling has
+* to happen before (see convert.h).
+*/
+typedef struct _blit_surface {
+  uint8_t *pixels;
+  uint32_t width;
+  uint32_t height;
+  uint32_t pitch;
+} blit_surface;
+
+typedef enum _blit_fit {
+  BLIT_FIT_CENTER = 0, /* No scaling, crop or pad around the center */
+  BLIT_FIT_CONTAIN,    /* Scale to fit inside, letterbox the rest */
+  BLIT_FIT_COVER,      /* Scale to fill, crop what hangs over */
+  BLIT_FIT_STRETCH,    /* Scale each axis independently */
+  BLIT_FIT_MAX
+} blit_fit;
+
+typedef enum _blit_filter {
+  BLIT_FILTER_NEAREST = 0,
+  BLIT_FILTER_BILINEAR,
+  BLIT_FILTER_MAX
+} blit_filter;
+
+/* Name lookups for command line parsing, return the _MAX value when unknown */
+blit_fit blit_fit_from_name(const char *name);
+blit_filter blit_filter_from_name(const char *name);
+
+/* Every destination pixel is written, uncovered areas get background */
+bool blit_image32(const blit_surface *dst, const blit_surface *src, blit_fit fit, blit_filter filter, uint32_t background);
+
+/**
+* Same result as blit_image32() but the source arrives one row at a time,
+* top to bottom, so a decoder can feed it without ever holding the whole
+* image. At most two source rows are kept. Borders are filled on create.
+*/
+typedef struct _blit_stream blit_stream;
+
+blit_stream *blit_stream_create(const blit_surface *dst, uint32_t src_width, uint32_t src_height, blit_fit fit, blit_filter filter, uint32_t background);
+void blit_stream_destroy(blit_stream *stream);
+
+/* Returns false if y isn't the row that comes after the previous one */
+bool blit_stream_row(blit_stream *stream, uint32_t y, const uint32_t *row);
+
+/* True once every destination row has been written */
+bool blit_stream_done(const blit_stream *stream);
+
+#endif
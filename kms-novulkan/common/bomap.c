@@ -0,0 +1,165 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/dma-buf.h>
+
+#include <xf86drm.h>
+
+#define LUCUR_DISPLAY_API
+#include <dluc/lucurious.h>
+
+#include "bomap.h"
+#include "fill.h"
+
+bool bo_map_create(bo_map *map, struct gbm_bo *bo, uint32_t width, uint32_t height) {
+  memset(map, 0, sizeof(bo_map));
+  map->dmabuf_fd = -1;
+  map->bo = bo;
+  map->width = width;
+  map->height = height;
+
+  /**
+  * gbm_bo_map() may hand back a staging copy with a stride of its own, which
+  * the dma-buf sync ioctls know nothing about. The dma-buf's own pages are the
+  * BO's, so the sync ioctls on it cover exactly what gets written.
+  */
+  map->dmabuf_fd = gbm_bo_get_fd(bo);
+  if (map->dmabuf_fd < 0) {
+    dlu_log_me(DLU_WARNING, "[x] gbm_bo_get_fd: %s, mapping every frame instead", strerror(errno));
+    return true;
+  }
+
+  uint32_t offset = gbm_bo_get_offset(bo, 0);
+  map->stride = gbm_bo_get_stride(bo);
+  map->mmap_size = (size_t) offset + (size_t) map->stride * height;
+
+  map->mmap_base = mmap(NULL, map->mmap_size, PROT_READ | PROT_WRITE, MAP_SHARED, map->dmabuf_fd, 0);
+  if (map->mmap_base == MAP_FAILED) {
+    dlu_log_me(DLU_WARNING, "[x] mmap: dma-buf: %s, mapping every frame instead", strerror(errno));
+    map->mmap_base = NULL;
+    map->mmap_size = 0;
+    map->stride = 0;
+    return true;
+  }
+
+  map->pixels = (uint8_t *) map->mmap_base + offset;
+  return true;
+}
+
+bool bo_map_create_dumb(bo_map *map, int kmsfd, const dumb_buf *dumb) {
+  memset(map, 0, sizeof(bo_map));
+  map->dmabuf_fd = -1;
+
+  map->pixels = dumb->pixels;
+  map->stride = dumb->pitch;
+  map->width = dumb->width;
+  map->height = dumb->height;
+
+  if (drmPrimeHandleToFD(kmsfd, dumb->handle, DRM_CLOEXEC | DRM_RDWR, &map->dmabuf_fd) == -1) {
+    dlu_log_me(DLU_WARNING, "[x] drmPrimeHandleToFD: %s, CPU access will not be synchronized", strerror(errno));
+    map->dmabuf_fd = -1;
+  }
+
+  return true;
+}
+
+void bo_map_destroy(bo_map *map) {
+  if (!map->bo && !map->pixels) return;
+  if (map->mmap_base) munmap(map->mmap_base, map->mmap_size);
+  else if (map->bo && map->map_data) gbm_bo_unmap(map->bo, map->map_data);
+  if (map->dmabuf_fd >= 0) close(map->dmabuf_fd);
+  memset(map, 0, sizeof(bo_map));
+  map->dmabuf_fd = -1;
+}
+
+static bool dmabuf_sync(int fd, uint64_t flags) {
+  struct dma_buf_sync sync = { .flags = flags };
+  int ret = 0;
+
+  if (fd < 0) return true;
+
+  do {
+    ret = ioctl(fd, DMA_BUF_IOCTL_SYNC, &sync);
+  } while (ret == -1 && (errno == EINTR || errno == EAGAIN));
+
+  if (ret == -1) {
+    dlu_log_me(DLU_DANGER, "[x] DMA_BUF_IOCTL_SYNC: %s", strerror(errno));
+    return false;
+  }
+
+  return true;
+}
+
+/* A GBM BO without a dma-buf mapping */
+static bool per_frame(const bo_map *map) {
+  return map->bo && !map->mmap_base;
+}
+
+bool bo_map_begin(bo_map *map) {
+  if (!per_frame(map)) return dmabuf_sync(map->dmabuf_fd, DMA_BUF_SYNC_START | DMA_BUF_SYNC_WRITE);
+
+  /* Read too, partial updates (a layer's rectangle) must not write stale staging memory back */
+  map->pixels = gbm_bo_map(map->bo, 0, 0, map->width, map->height, GBM_BO_TRANSFER_READ_WRITE, &map->stride, &map->map_data);
+  if (!map->pixels) {
+    dlu_log_me(DLU_DANGER, "[x] gbm_bo_map: %s", strerror(errno));
+    map->map_data = NULL;
+    return false;
+  }
+
+  return true;
+}
+
+bool bo_map_end(bo_map *map) {
+  if (!per_frame(map)) return dmabuf_sync(map->dmabuf_fd, DMA_BUF_SYNC_END | DMA_BUF_SYNC_WRITE);
+
+  if (map->map_data) gbm_bo_unmap(map->bo, map->map_data);
+  map->map_data = NULL;
+  map->pixels = NULL;
+  return true;
+}
+
+int bo_map_export_fence(bo_map *map) {
+#ifdef DMA_BUF_IOCTL_EXPORT_SYNC_FILE
+  struct dma_buf_export_sync_file sync = { .flags = DMA_BUF_SYNC_READ, .fd = -1 };
+
+  if (ioctl(map->dmabuf_fd, DMA_BUF_IOCTL_EXPORT_SYNC_FILE, &sync) == -1) return -1;
+  return sync.fd;
+#else
+  (void) map;
+  return -1;
+#endif
+}
+
+void bo_map_copy(bo_map *map, const uint8_t *src, uint32_t src_pitch, uint32_t row_bytes, uint32_t rows) {
+  if (rows > map->height) rows = map->height;
+  if (row_bytes > map->stride) row_bytes = map->stride;
+
+  fill_copy_rows(map->pixels, map->stride, src, src_pitch, row_bytes, rows);
+}
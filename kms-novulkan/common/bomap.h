@@ -0,0 +1,82 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#ifndef BOMAP_H
+#define BOMAP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <gbm.h>
+
+#include "dumbbuf.h"
+
+/**
+* Keeps a scanout BO mapped for the lifetime of the program so draw_screen
+* can write into it directly instead of going through a staging buffer and
+* gbm_bo_write(). The mapping is an mmap of the BO's dma-buf, laid out with
+* gbm_bo_get_stride(), and every CPU access has to be wrapped in bo_map_begin()
+* and bo_map_end() so the kernel can flush caches around it (DMA_BUF_IOCTL_SYNC
+* on that same dma-buf).
+*
+* A driver that can't mmap its dma-bufs gets gbm_bo_map() in bo_map_begin() and
+* gbm_bo_unmap() in bo_map_end() instead, pixels and stride are only good in
+* between.
+*/
+typedef struct _bo_map {
+  struct gbm_bo *bo;
+  void *map_data; /* Opaque handle gbm_bo_map() wants back in gbm_bo_unmap(), per frame mappings only */
+  uint8_t *pixels;
+  uint32_t stride;
+  uint32_t width;
+  uint32_t height;
+  int dmabuf_fd;
+  void *mmap_base; /* The dma-buf mapping, NULL when mapping per frame */
+  size_t mmap_size;
+} bo_map;
+
+bool bo_map_create(bo_map *map, struct gbm_bo *bo, uint32_t width, uint32_t height);
+
+/**
+* A view of a dumb buffer from dumb_buf_fb_create(), which keeps owning the
+* buffer and its mapping. Dumb mappings are write-combined, draw into them with
+* the streaming fill kernels.
+*/
+bool bo_map_create_dumb(bo_map *map, int kmsfd, const dumb_buf *dumb);
+void bo_map_destroy(bo_map *map);
+
+bool bo_map_begin(bo_map *map);
+bool bo_map_end(bo_map *map);
+
+/**
+* sync_file holding the fences a reader of the BO has to wait for (its pending
+* writes), to hand to the display as IN_FENCE_FD. -1 if the kernel can't export
+* one (DMA_BUF_IOCTL_EXPORT_SYNC_FILE is Linux 6.0+).
+*/
+int bo_map_export_fence(bo_map *map);
+
+/* Copy rows of row_bytes from src (src_pitch apart) into the mapping using its real stride */
+void bo_map_copy(bo_map *map, const uint8_t *src, uint32_t src_pitch, uint32_t row_bytes, uint32_t rows);
+
+#endif
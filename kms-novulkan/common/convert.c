@@ -0,0 +1,324 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CONVERT_HAVE_X86
+#include <immintrin.h>
+#endif
+
+#include "convert.h"
+
+typedef void (*convert32_fn)(uint32_t *dst, const uint8_t *src, uint32_t count);
+typedef void (*convert16_fn)(uint16_t *dst, const uint8_t *src, uint32_t count);
+
+typedef struct _convert_ops {
+  convert32_fn rgba_to_xrgb8888;
+  convert32_fn rgb_to_xrgb8888;
+  convert16_fn rgba_to_rgb565;
+  convert32_fn rgba_to_argb8888_premul;
+} convert_ops;
+
+static const char *kernel_names[CONVERT_KERNEL_MAX] = {
+  "auto", "scalar", "ssse3", "avx2"
+};
+
+/* Exact c * a / 255 rounded to nearest, the SIMD kernels use the same formula */
+static inline uint32_t mul_div255(uint32_t c, uint32_t a) {
+  uint32_t x = c * a + 128;
+  return (x + (x >> 8)) >> 8;
+}
+
+static void rgba_to_xrgb8888_scalar(uint32_t *dst, const uint8_t *src, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++, src += 4)
+    dst[i] = 0xff000000u | ((uint32_t) src[0] << 16) | ((uint32_t) src[1] << 8) | src[2];
+}
+
+static void rgb_to_xrgb8888_scalar(uint32_t *dst, const uint8_t *src, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++, src += 3)
+    dst[i] = 0xff000000u | ((uint32_t) src[0] << 16) | ((uint32_t) src[1] << 8) | src[2];
+}
+
+static void rgba_to_rgb565_scalar(uint16_t *dst, const uint8_t *src, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++, src += 4)
+    dst[i] = (uint16_t) (((src[0] & 0xf8) << 8) | ((src[1] & 0xfc) << 3) | (src[2] >> 3));
+}
+
+static void rgba_to_argb8888_premul_scalar(uint32_t *dst, const uint8_t *src, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++, src += 4) {
+    uint32_t a = src[3];
+    dst[i] = (a << 24) | (mul_div255(src[0], a) << 16) | (mul_div255(src[1], a) << 8) | mul_div255(src[2], a);
+  }
+}
+
+#ifdef CONVERT_HAVE_X86
+#define Z 0x80 /* pshufb index that produces a zero byte */
+
+/* R G B A -> B G R A within every pixel */
+#define SWAP_RB_MASK 2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15
+/* 4 packed R G B triplets -> B G R 0 */
+#define RGB_EXPAND_MASK 2, 1, 0, Z, 5, 4, 3, Z, 8, 7, 6, Z, 11, 10, 9, Z
+/* Low 16 bits of every 32 bit lane packed into the low 8 bytes */
+#define PACK16_MASK 0, 1, 4, 5, 8, 9, 12, 13, Z, Z, Z, Z, Z, Z, Z, Z
+/* Pixel bytes widened to 16 bit lanes, swizzled to B G R A */
+#define WIDEN_LO_MASK 2, Z, 1, Z, 0, Z, 3, Z, 6, Z, 5, Z, 4, Z, 7, Z
+#define WIDEN_HI_MASK 10, Z, 9, Z, 8, Z, 11, Z, 14, Z, 13, Z, 12, Z, 15, Z
+/* Alpha of each pixel broadcast to its B G R lanes, the A lane gets 255 (patched in below) */
+#define ALPHA_LO_MASK 3, Z, 3, Z, 3, Z, Z, Z, 7, Z, 7, Z, 7, Z, Z, Z
+#define ALPHA_HI_MASK 11, Z, 11, Z, 11, Z, Z, Z, 15, Z, 15, Z, 15, Z, Z, Z
+
+__attribute__((target("ssse3")))
+static void rgba_to_xrgb8888_ssse3(uint32_t *dst, const uint8_t *src, uint32_t count) {
+  const __m128i mask = _mm_setr_epi8(SWAP_RB_MASK);
+  const __m128i alpha = _mm_set1_epi32((int) 0xff000000u);
+  uint32_t i = 0;
+
+  for (; i + 4 <= count; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i *) (src + i * 4));
+    _mm_storeu_si128((__m128i *) (dst + i), _mm_or_si128(_mm_shuffle_epi8(v, mask), alpha));
+  }
+
+  rgba_to_xrgb8888_scalar(dst + i, src + i * 4, count - i);
+}
+
+__attribute__((target("ssse3")))
+static void rgb_to_xrgb8888_ssse3(uint32_t *dst, const uint8_t *src, uint32_t count) {
+  const __m128i mask = _mm_setr_epi8(RGB_EXPAND_MASK);
+  const __m128i alpha = _mm_set1_epi32((int) 0xff000000u);
+  uint32_t i = 0;
+
+  /* 16 byte loads consume 12, stop while a full load still stays inside src */
+  for (; i + 6 <= count; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i *) (src + i * 3));
+    _mm_storeu_si128((__m128i *) (dst + i), _mm_or_si128(_mm_shuffle_epi8(v, mask), alpha));
+  }
+
+  rgb_to_xrgb8888_scalar(dst + i, src + i * 3, count - i);
+}
+
+__attribute__((target("ssse3")))
+static inline __m128i rgb565_4px_ssse3(__m128i v) {
+  __m128i r = _mm_slli_epi32(_mm_and_si128(v, _mm_set1_epi32(0xf8)), 8);
+  __m128i g = _mm_srli_epi32(_mm_and_si128(v, _mm_set1_epi32(0xfc00)), 5);
+  __m128i b = _mm_and_si128(_mm_srli_epi32(v, 19), _mm_set1_epi32(0x1f));
+  return _mm_shuffle_epi8(_mm_or_si128(_mm_or_si128(r, g), b), _mm_setr_epi8(PACK16_MASK));
+}
+
+__attribute__((target("ssse3")))
+static void rgba_to_rgb565_ssse3(uint16_t *dst, const uint8_t *src, uint32_t count) {
+  uint32_t i = 0;
+
+  for (; i + 8 <= count; i += 8) {
+    __m128i lo = rgb565_4px_ssse3(_mm_loadu_si128((const __m128i *) (src + i * 4)));
+    __m128i hi = rgb565_4px_ssse3(_mm_loadu_si128((const __m128i *) (src + i * 4 + 16)));
+    _mm_storeu_si128((__m128i *) (dst + i), _mm_unpacklo_epi64(lo, hi));
+  }
+
+  rgba_to_rgb565_scalar(dst + i, src + i * 4, count - i);
+}
+
+/* c * a / 255 on 16 bit lanes, same rounding as mul_div255() */
+__attribute__((target("ssse3")))
+static inline __m128i mul_div255_epi16_ssse3(__m128i c, __m128i a) {
+  __m128i x = _mm_add_epi16(_mm_mullo_epi16(c, a), _mm_set1_epi16(128));
+  return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+__attribute__((target("ssse3")))
+static void rgba_to_argb8888_premul_ssse3(uint32_t *dst, const uint8_t *src, uint32_t count) {
+  const __m128i a_lane = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+  uint32_t i = 0;
+
+  for (; i + 4 <= count; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i *) (src + i * 4));
+
+    __m128i lo = _mm_shuffle_epi8(v, _mm_setr_epi8(WIDEN_LO_MASK));
+    __m128i hi = _mm_shuffle_epi8(v, _mm_setr_epi8(WIDEN_HI_MASK));
+    __m128i alo = _mm_or_si128(_mm_shuffle_epi8(v, _mm_setr_epi8(ALPHA_LO_MASK)), a_lane);
+    __m128i ahi = _mm_or_si128(_mm_shuffle_epi8(v, _mm_setr_epi8(ALPHA_HI_MASK)), a_lane);
+
+    lo = mul_div255_epi16_ssse3(lo, alo);
+    hi = mul_div255_epi16_ssse3(hi, ahi);
+    _mm_storeu_si128((__m128i *) (dst + i), _mm_packus_epi16(lo, hi));
+  }
+
+  rgba_to_argb8888_premul_scalar(dst + i, src + i * 4, count - i);
+}
+
+__attribute__((target("avx2")))
+static void rgba_to_xrgb8888_avx2(uint32_t *dst, const uint8_t *src, uint32_t count) {
+  const __m256i mask = _mm256_setr_epi8(SWAP_RB_MASK, SWAP_RB_MASK);
+  const __m256i alpha = _mm256_set1_epi32((int) 0xff000000u);
+  uint32_t i = 0;
+
+  for (; i + 8 <= count; i += 8) {
+    __m256i v = _mm256_loadu_si256((const __m256i *) (src + i * 4));
+    _mm256_storeu_si256((__m256i *) (dst + i), _mm256_or_si256(_mm256_shuffle_epi8(v, mask), alpha));
+  }
+
+  rgba_to_xrgb8888_ssse3(dst + i, src + i * 4, count - i);
+}
+
+__attribute__((target("avx2")))
+static void rgb_to_xrgb8888_avx2(uint32_t *dst, const uint8_t *src, uint32_t count) {
+  const __m256i mask = _mm256_setr_epi8(RGB_EXPAND_MASK, RGB_EXPAND_MASK);
+  const __m256i alpha = _mm256_set1_epi32((int) 0xff000000u);
+  uint32_t i = 0;
+
+  /* Each 128 bit lane takes 4 pixels (12 bytes) from its own 16 byte load */
+  for (; i + 10 <= count; i += 8) {
+    __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *) (src + i * 3))),
+                                        _mm_loadu_si128((const __m128i *) (src + i * 3 + 12)), 1);
+    _mm256_storeu_si256((__m256i *) (dst + i), _mm256_or_si256(_mm256_shuffle_epi8(v, mask), alpha));
+  }
+
+  rgb_to_xrgb8888_ssse3(dst + i, src + i * 3, count - i);
+}
+
+__attribute__((target("avx2")))
+static void rgba_to_rgb565_avx2(uint16_t *dst, const uint8_t *src, uint32_t count) {
+  const __m256i pack = _mm256_setr_epi8(PACK16_MASK, PACK16_MASK);
+  uint32_t i = 0;
+
+  for (; i + 8 <= count; i += 8) {
+    __m256i v = _mm256_loadu_si256((const __m256i *) (src + i * 4));
+    __m256i r = _mm256_slli_epi32(_mm256_and_si256(v, _mm256_set1_epi32(0xf8)), 8);
+    __m256i g = _mm256_srli_epi32(_mm256_and_si256(v, _mm256_set1_epi32(0xfc00)), 5);
+    __m256i b = _mm256_and_si256(_mm256_srli_epi32(v, 19), _mm256_set1_epi32(0x1f));
+    __m256i p = _mm256_shuffle_epi8(_mm256_or_si256(_mm256_or_si256(r, g), b), pack);
+    /* Both lanes hold 4 results in their low 8 bytes, gather qwords 0 and 2 */
+    p = _mm256_permute4x64_epi64(p, 0x08);
+    _mm_storeu_si128((__m128i *) (dst + i), _mm256_castsi256_si128(p));
+  }
+
+  rgba_to_rgb565_ssse3(dst + i, src + i * 4, count - i);
+}
+
+__attribute__((target("avx2")))
+static void rgba_to_argb8888_premul_avx2(uint32_t *dst, const uint8_t *src, uint32_t count) {
+  const __m256i a_lane = _mm256_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255);
+  const __m256i round = _mm256_set1_epi16(128);
+  uint32_t i = 0;
+
+  for (; i + 8 <= count; i += 8) {
+    __m256i v = _mm256_loadu_si256((const __m256i *) (src + i * 4));
+
+    __m256i lo = _mm256_shuffle_epi8(v, _mm256_setr_epi8(WIDEN_LO_MASK, WIDEN_LO_MASK));
+    __m256i hi = _mm256_shuffle_epi8(v, _mm256_setr_epi8(WIDEN_HI_MASK, WIDEN_HI_MASK));
+    __m256i alo = _mm256_or_si256(_mm256_shuffle_epi8(v, _mm256_setr_epi8(ALPHA_LO_MASK, ALPHA_LO_MASK)), a_lane);
+    __m256i ahi = _mm256_or_si256(_mm256_shuffle_epi8(v, _mm256_setr_epi8(ALPHA_HI_MASK, ALPHA_HI_MASK)), a_lane);
+
+    lo = _mm256_add_epi16(_mm256_mullo_epi16(lo, alo), round);
+    lo = _mm256_srli_epi16(_mm256_add_epi16(lo, _mm256_srli_epi16(lo, 8)), 8);
+    hi = _mm256_add_epi16(_mm256_mullo_epi16(hi, ahi), round);
+    hi = _mm256_srli_epi16(_mm256_add_epi16(hi, _mm256_srli_epi16(hi, 8)), 8);
+
+    /* packus works per 128 bit lane, which is exactly how lo/hi were split */
+    _mm256_storeu_si256((__m256i *) (dst + i), _mm256_packus_epi16(lo, hi));
+  }
+
+  rgba_to_argb8888_premul_ssse3(dst + i, src + i * 4, count - i);
+}
+#endif
+
+static const convert_ops kernel_ops[CONVERT_KERNEL_MAX] = {
+  [CONVERT_KERNEL_SCALAR] = {
+    rgba_to_xrgb8888_scalar, rgb_to_xrgb8888_scalar, rgba_to_rgb565_scalar, rgba_to_argb8888_premul_scalar
+  },
+#ifdef CONVERT_HAVE_X86
+  [CONVERT_KERNEL_SSSE3] = {
+    rgba_to_xrgb8888_ssse3, rgb_to_xrgb8888_ssse3, rgba_to_rgb565_ssse3, rgba_to_argb8888_premul_ssse3
+  },
+  [CONVERT_KERNEL_AVX2] = {
+    rgba_to_xrgb8888_avx2, rgb_to_xrgb8888_avx2, rgba_to_rgb565_avx2, rgba_to_argb8888_premul_avx2
+  },
+#endif
+};
+
+static const convert_ops *cur_ops = NULL;
+static convert_kernel cur_kernel = CONVERT_KERNEL_AUTO;
+
+bool convert_kernel_supported(convert_kernel kernel) {
+  switch (kernel) {
+    case CONVERT_KERNEL_AUTO: return true;
+    case CONVERT_KERNEL_SCALAR: return true;
+#ifdef CONVERT_HAVE_X86
+    case CONVERT_KERNEL_SSSE3: return __builtin_cpu_supports("ssse3");
+    case CONVERT_KERNEL_AVX2: return __builtin_cpu_supports("avx2");
+#endif
+    default: return false;
+  }
+}
+
+bool convert_set_kernel(convert_kernel kernel) {
+  if (kernel >= CONVERT_KERNEL_MAX || !convert_kernel_supported(kernel)) return false;
+
+  if (kernel == CONVERT_KERNEL_AUTO) {
+#ifdef CONVERT_HAVE_X86
+    __builtin_cpu_init();
+#endif
+    kernel = CONVERT_KERNEL_SCALAR;
+    for (convert_kernel k = CONVERT_KERNEL_MAX - 1; k > CONVERT_KERNEL_SCALAR; k--)
+      if (convert_kernel_supported(k)) { kernel = k; break; }
+  }
+
+  cur_ops = &kernel_ops[kernel];
+  cur_kernel = kernel;
+
+  return true;
+}
+
+convert_kernel convert_get_kernel(void) {
+  if (!cur_ops) convert_set_kernel(CONVERT_KERNEL_AUTO);
+  return cur_kernel;
+}
+
+const char *convert_kernel_name(convert_kernel kernel) {
+  return (kernel < CONVERT_KERNEL_MAX) ? kernel_names[kernel] : "unknown";
+}
+
+static inline const convert_ops *ops(void) {
+  if (!cur_ops) convert_set_kernel(CONVERT_KERNEL_AUTO);
+  return cur_ops;
+}
+
+void convert_rgba_to_xrgb8888(uint32_t *dst, const uint8_t *src, uint32_t count) {
+  ops()->rgba_to_xrgb8888(dst, src, count);
+}
+
+void convert_rgb_to_xrgb8888(uint32_t *dst, const uint8_t *src, uint32_t count) {
+  ops()->rgb_to_xrgb8888(dst, src, count);
+}
+
+void convert_rgba_to_rgb565(uint16_t *dst, const uint8_t *src, uint32_t count) {
+  ops()->rgba_to_rgb565(dst, src, count);
+}
+
+void convert_rgba_to_argb8888_premul(uint32_t *dst, const uint8_t *src, uint32_t count) {
+  ops()->rgba_to_argb8888_premul(dst, src, count);
+}
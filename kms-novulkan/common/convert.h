@@ -0,0 +1,58 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#ifndef CONVERT_H
+#define CONVERT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+* Converts decoded image bytes (stbi order: R, G, B[, A]) into DRM framebuffer
+* formats. DRM formats are little endian, so XRGB8888 is B, G, R, X in memory.
+* The RGBA -> 32 bit conversions may be done in place (dst == src).
+*/
+typedef enum _convert_kernel {
+  CONVERT_KERNEL_AUTO = 0,
+  CONVERT_KERNEL_SCALAR,
+  CONVERT_KERNEL_SSSE3,
+  CONVERT_KERNEL_AVX2,
+  CONVERT_KERNEL_MAX
+} convert_kernel;
+
+bool convert_kernel_supported(convert_kernel kernel);
+bool convert_set_kernel(convert_kernel kernel);
+convert_kernel convert_get_kernel(void);
+const char *convert_kernel_name(convert_kernel kernel);
+
+/* X is written as 0xff */
+void convert_rgba_to_xrgb8888(uint32_t *dst, const uint8_t *src, uint32_t count);
+void convert_rgb_to_xrgb8888(uint32_t *dst, const uint8_t *src, uint32_t count);
+
+void convert_rgba_to_rgb565(uint16_t *dst, const uint8_t *src, uint32_t count);
+
+/* Color channels multiplied by alpha, which also makes it correct XRGB over black */
+void convert_rgba_to_argb8888_premul(uint32_t *dst, const uint8_t *src, uint32_t count);
+
+#endif
@@ -0,0 +1,57 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#define LUCUR_DISPLAY_API
+#include <dluc/lucurious.h>
+
+#include "cpustat.h"
+
+void cpu_stat_now(cpu_stat *stat) {
+  struct timespec ts;
+  struct rusage usage;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  getrusage(RUSAGE_SELF, &usage); /* Every thread, fill pool workers included */
+
+  stat->wall = ts.tv_sec + ts.tv_nsec * 1e-9;
+  stat->user = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6;
+  stat->sys = usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+}
+
+void cpu_stat_report(const cpu_stat *start, const char *label) {
+  cpu_stat end;
+  cpu_stat_now(&end);
+
+  double wall = end.wall - start->wall, user = end.user - start->user, sys = end.sys - start->sys;
+  if (wall <= 0) return;
+
+  dlu_log_me(DLU_INFO, "%s: %.2fs user + %.2fs sys over %.2fs, %.1f%% of one core",
+             label, user, sys, wall, (user + sys) / wall * 100.0);
+}
@@ -0,0 +1,145 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+#define LUCUR_DISPLAY_API
+#include <dluc/lucurious.h>
+
+#include "deadline.h"
+
+#define MARGIN_MIN 0.0005
+#define PERIOD_WEIGHT 0.1 /* Refresh clocks barely drift, a slow average is plenty */
+#define FILL_DECAY 0.05   /* Jumps straight up to a slower frame, creeps back down */
+
+double deadline_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+bool deadline_init(deadline *dl, uint32_t refresh) {
+  memset(dl, 0, sizeof(deadline));
+
+  dl->timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (dl->timerfd == -1) {
+    dlu_log_me(DLU_DANGER, "[x] timerfd_create: %s", strerror(errno));
+    return false;
+  }
+
+  dl->period = 1.0 / ((refresh) ? refresh : 60);
+  dl->margin = 0.001;
+  return true;
+}
+
+void deadline_fini(deadline *dl) {
+  if (dl->timerfd >= 0) close(dl->timerfd);
+  dl->timerfd = -1;
+}
+
+void deadline_flipped(deadline *dl, uint32_t sequence, uint32_t tv_sec, uint32_t tv_usec) {
+  double when = tv_sec + tv_usec * 1e-6; /* The kernel timestamps flip events with CLOCK_MONOTONIC */
+  uint32_t delta = sequence - dl->last_seq;
+
+  if (dl->have_vblank && delta && delta < 8)
+    dl->period += ((when - dl->last_vblank) / delta - dl->period) * PERIOD_WEIGHT;
+
+  /* Only a frame drawn on the timer says anything about the margin */
+  if (dl->drawn) {
+    if ((int32_t) (sequence - dl->target_seq) > 0) {
+      dl->missed++;
+      dl->margin = dl->margin * 2 + MARGIN_MIN;
+      if (dl->margin > dl->period / 2) dl->margin = dl->period / 2;
+    } else {
+      dl->on_time++;
+      dl->margin *= 0.99;
+      if (dl->margin < MARGIN_MIN) dl->margin = MARGIN_MIN;
+    }
+    dl->drawn = false;
+  }
+
+  dl->last_vblank = when;
+  dl->last_seq = sequence;
+  dl->have_vblank = true;
+}
+
+bool deadline_arm(deadline *dl) {
+  double now = deadline_now(), start = 0;
+  uint32_t ahead = 1;
+
+  if (dl->armed) return true;
+
+  /* First vblank whose start time hasn't passed yet */
+  while ((start = dl->last_vblank + dl->period * ahead - dl->fill - dl->margin) < now && ahead < 8)
+    ahead++;
+
+  /* Nothing to go on yet, or way behind: draw right away */
+  if (!dl->have_vblank || start < now) start = now;
+
+  struct itimerspec its;
+  memset(&its, 0, sizeof(its));
+  its.it_value.tv_sec = (time_t) start;
+  its.it_value.tv_nsec = (long) ((start - (time_t) start) * 1e9);
+  if (!its.it_value.tv_sec && !its.it_value.tv_nsec) its.it_value.tv_nsec = 1; /* Zero would disarm */
+
+  if (timerfd_settime(dl->timerfd, TFD_TIMER_ABSTIME, &its, NULL) == -1) {
+    dlu_log_me(DLU_DANGER, "[x] timerfd_settime: %s", strerror(errno));
+    return false;
+  }
+
+  dl->target_seq = dl->last_seq + ahead;
+  dl->armed = true;
+  return true;
+}
+
+void deadline_fired(deadline *dl) {
+  uint64_t expirations = 0;
+
+  /* Non-blocking, a spurious wakeup just reads EAGAIN */
+  if (read(dl->timerfd, &expirations, sizeof(expirations)) == -1 && errno != EAGAIN)
+    dlu_log_me(DLU_WARNING, "[x] read: timerfd: %s", strerror(errno));
+
+  dl->armed = false;
+  dl->drawn = dl->have_vblank;
+}
+
+void deadline_fill_time(deadline *dl, double seconds) {
+  if (seconds > dl->fill) dl->fill = seconds;
+  else dl->fill += (seconds - dl->fill) * FILL_DECAY;
+}
+
+void deadline_report(const deadline *dl) {
+  if (!dl->on_time && !dl->missed) return;
+
+  dlu_log_me(DLU_INFO, "Late rendering: %.3f ms period, %.3f ms fill, %.3f ms margin, %" PRIu64 " on time, %" PRIu64 " missed",
+             dl->period * 1e3, dl->fill * 1e3, dl->margin * 1e3, dl->on_time, dl->missed);
+}
@@ -0,0 +1,78 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#ifndef DEADLINE_H
+#define DEADLINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+* Schedules drawing as late as possible: just early enough that the frame is
+* done and flipped before the next vblank. The refresh period and vblank
+* phase come from flip completion timestamps, the fill time from measuring
+* each frame. The safety margin doubles on a missed vblank and slowly shrinks
+* again while frames make it. The timer is a timerfd, so it sits in the epoll
+* loop like any other source.
+*/
+typedef struct _deadline {
+  int timerfd;
+
+  double period; /* Seconds between vblanks */
+  double last_vblank; /* CLOCK_MONOTONIC seconds of the last flip completion */
+  uint32_t last_seq;
+  bool have_vblank;
+
+  double fill; /* Estimated time to draw and submit a frame */
+  double margin;
+  uint32_t target_seq; /* Vblank the frame drawn on the timer is meant for */
+  bool armed;
+  bool drawn; /* Timer fired, the next flip completion tells whether target_seq was made */
+
+  uint64_t on_time;
+  uint64_t missed;
+} deadline;
+
+/* refresh is the mode's refresh rate in Hz, only used until flips come in */
+bool deadline_init(deadline *dl, uint32_t refresh);
+void deadline_fini(deadline *dl);
+
+/* A flip completed, timestamps as passed to the DRM event handler */
+void deadline_flipped(deadline *dl, uint32_t sequence, uint32_t tv_sec, uint32_t tv_usec);
+
+/* Arms the timer for the next vblank that can still be made */
+bool deadline_arm(deadline *dl);
+
+/* Call when the timer fires, consumes the expiration */
+void deadline_fired(deadline *dl);
+
+/* How long the frame took from the timer firing to being submitted */
+void deadline_fill_time(deadline *dl, double seconds);
+
+void deadline_report(const deadline *dl);
+
+/* CLOCK_MONOTONIC in seconds */
+double deadline_now(void);
+
+#endif
@@ -0,0 +1,124 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
+
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+#include <drm_fourcc.h>
+
+#define LUCUR_DISPLAY_API
+#include <dluc/lucurious.h>
+
+#include "dumbbuf.h"
+
+bool dumb_buf_create(dumb_buf *buf, int kmsfd, uint32_t width, uint32_t height) {
+  struct drm_mode_create_dumb create;
+  struct drm_mode_map_dumb map;
+
+  memset(buf, 0, sizeof(dumb_buf));
+  memset(&create, 0, sizeof(create));
+  memset(&map, 0, sizeof(map));
+
+  create.width = width;
+  create.height = height;
+  create.bpp = 32;
+  if (drmIoctl(kmsfd, DRM_IOCTL_MODE_CREATE_DUMB, &create) < 0) {
+    dlu_log_me(DLU_DANGER, "[x] DRM_IOCTL_MODE_CREATE_DUMB: %s", strerror(errno));
+    return false;
+  }
+
+  buf->handle = create.handle;
+  buf->width = width;
+  buf->height = height;
+  buf->pitch = create.pitch;
+  buf->size = create.size;
+
+  uint32_t handles[4] = { buf->handle }, pitches[4] = { buf->pitch }, offsets[4] = { 0 };
+  if (drmModeAddFB2(kmsfd, width, height, DRM_FORMAT_XRGB8888, handles, pitches, offsets, &buf->fb_id, 0) < 0) {
+    dlu_log_me(DLU_DANGER, "[x] drmModeAddFB2: %s", strerror(errno));
+    goto exit_dumb;
+  }
+
+  map.handle = buf->handle;
+  if (drmIoctl(kmsfd, DRM_IOCTL_MODE_MAP_DUMB, &map) < 0) {
+    dlu_log_me(DLU_DANGER, "[x] DRM_IOCTL_MODE_MAP_DUMB: %s", strerror(errno));
+    goto exit_dumb;
+  }
+
+  buf->pixels = mmap(NULL, buf->size, PROT_READ | PROT_WRITE, MAP_SHARED, kmsfd, map.offset);
+  if (buf->pixels == MAP_FAILED) {
+    dlu_log_me(DLU_DANGER, "[x] mmap: %s", strerror(errno));
+    buf->pixels = NULL;
+    goto exit_dumb;
+  }
+
+  return true;
+
+exit_dumb:
+  dumb_buf_destroy(buf, kmsfd);
+  return false;
+}
+
+void dumb_buf_destroy(dumb_buf *buf, int kmsfd) {
+  if (buf->pixels) munmap(buf->pixels, buf->size);
+  if (buf->fb_id) drmModeRmFB(kmsfd, buf->fb_id);
+
+  if (buf->handle) {
+    struct drm_mode_destroy_dumb destroy = { .handle = buf->handle };
+    drmIoctl(kmsfd, DRM_IOCTL_MODE_DESTROY_DUMB, &destroy);
+  }
+
+  memset(buf, 0, sizeof(dumb_buf));
+}
+
+bool dumb_buf_fb_create(dumb_buf *bufs, dlu_disp_core *core, uint32_t cur_odb, uint32_t base, uint32_t count) {
+  uint32_t width = core->output_data[cur_odb].mode.hdisplay, height = core->output_data[cur_odb].mode.vdisplay;
+
+  for (uint32_t i = 0; i < count; i++) {
+    dlu_disp_buff_data *bd = &core->buff_data[base + i];
+
+    if (!dumb_buf_create(&bufs[i], core->device.kmsfd, width, height)) return false;
+
+    memset(bd, 0, sizeof(dlu_disp_buff_data));
+    bd->odid = cur_odb;
+    bd->fb_id = bufs[i].fb_id;
+    bd->pitches[0] = bufs[i].pitch;
+  }
+
+  return true;
+}
+
+void dumb_buf_fb_destroy(dumb_buf *bufs, dlu_disp_core *core, uint32_t base, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    dumb_buf_destroy(&bufs[i], core->device.kmsfd);
+    /* Already removed, the core mustn't remove it again */
+    core->buff_data[base + i].fb_id = 0;
+  }
+}
@@ -0,0 +1,63 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#ifndef DUMBBUF_H
+#define DUMBBUF_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define LUCUR_DISPLAY_API
+#include <dluc/lucurious.h>
+
+/**
+* A dumb buffer: linear XRGB8888 memory from the KMS driver itself, no GBM
+* involved, with a framebuffer id and a CPU mapping that lasts as long as the
+* buffer. Every KMS driver has them, which makes them the buffer of choice for
+* small CPU-drawn layers that sit on a plane of their own.
+*/
+typedef struct _dumb_buf {
+  uint32_t handle;
+  uint32_t fb_id;
+  uint32_t width;
+  uint32_t height;
+  uint32_t pitch;
+  uint64_t size;
+  uint8_t *pixels;
+} dumb_buf;
+
+bool dumb_buf_create(dumb_buf *buf, int kmsfd, uint32_t width, uint32_t height);
+void dumb_buf_destroy(dumb_buf *buf, int kmsfd);
+
+/**
+* Stands in for dlu_fb_create() with the dumb buffer backend (-d). count dumb
+* buffers the size of output cur_odb's mode, kept in bufs, go into
+* core->buff_data[base] onwards, so modesets, page flips and atomic commits
+* scan out of them with no GBM BO behind them. dumb_buf_fb_destroy() has to
+* run before the core is freed.
+*/
+bool dumb_buf_fb_create(dumb_buf *bufs, dlu_disp_core *core, uint32_t cur_odb, uint32_t base, uint32_t count);
+void dumb_buf_fb_destroy(dumb_buf *bufs, dlu_disp_core *core, uint32_t base, uint32_t count);
+
+#endif
@@ -0,0 +1,201 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+#define LUCUR_DISPLAY_API
+#include <dluc/lucurious.h>
+
+#include "evloop.h"
+
+bool ev_loop_init(ev_loop *loop) {
+  memset(loop, 0, sizeof(ev_loop));
+
+  loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+  if (loop->epfd == -1) {
+    dlu_log_me(DLU_DANGER, "[x] epoll_create1: %s", strerror(errno));
+    return false;
+  }
+
+  return true;
+}
+
+void ev_loop_fini(ev_loop *loop) {
+  if (loop->epfd >= 0) close(loop->epfd);
+  loop->epfd = -1;
+}
+
+ev_source *ev_loop_add(ev_loop *loop, int fd, const char *name, ev_handler handler, void *data) {
+  ev_source *src = NULL;
+
+  /* Slots of removed sources get reused, epoll holds pointers to the others */
+  for (uint32_t i = 0; i < loop->source_cnt && !src; i++)
+    if (!loop->sources[i].handler) src = &loop->sources[i];
+
+  if (!src && loop->source_cnt == EV_LOOP_MAX_SOURCES) {
+    dlu_log_me(DLU_DANGER, "[x] Too many event sources, %s not added", name);
+    return NULL;
+  }
+
+  /* Draining a source means reading until there's nothing left, which must never block */
+  int flags = fcntl(fd, F_GETFL);
+  if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+    dlu_log_me(DLU_DANGER, "[x] fcntl: %s: %s", name, strerror(errno));
+    return NULL;
+  }
+
+  if (!src) src = &loop->sources[loop->source_cnt];
+  memset(src, 0, sizeof(ev_source));
+  src->fd = fd;
+  src->name = name;
+  src->data = data;
+
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN | EPOLLET;
+  event.data.ptr = src;
+
+  if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, fd, &event) == -1) {
+    dlu_log_me(DLU_DANGER, "[x] epoll_ctl: %s: %s", name, strerror(errno));
+    return NULL;
+  }
+
+  src->handler = handler;
+  if (src == &loop->sources[loop->source_cnt]) loop->source_cnt++;
+  return src;
+}
+
+void ev_loop_remove(ev_loop *loop, ev_source *src) {
+  if (!src->handler) return;
+
+  epoll_ctl(loop->epfd, EPOLL_CTL_DEL, src->fd, NULL);
+  loop->removed_wakeups += src->wakeups;
+  loop->removed_syscalls += src->syscalls;
+
+  src->handler = NULL;
+  src->fd = -1;
+}
+
+bool ev_loop_dispatch(ev_loop *loop) {
+  struct epoll_event events[EV_LOOP_MAX_SOURCES];
+
+  int ready = epoll_wait(loop->epfd, events, EV_LOOP_MAX_SOURCES, -1);
+  loop->waits++;
+
+  if (ready == -1) {
+    if (errno == EINTR) return true;
+    dlu_log_me(DLU_DANGER, "[x] epoll_wait: %s", strerror(errno));
+    return false;
+  }
+
+  for (int i = 0; i < ready; i++) {
+    ev_source *src = (ev_source *) events[i].data.ptr;
+    if (!src->handler) continue; /* Removed by an earlier handler in this batch */
+    src->wakeups++;
+    if (!src->handler(src)) return false;
+  }
+
+  return true;
+}
+
+void ev_loop_report(const ev_loop *loop, uint64_t frames) {
+  uint64_t syscalls = loop->waits + loop->removed_syscalls;
+
+  for (uint32_t i = 0; i < loop->source_cnt; i++) {
+    const ev_source *src = &loop->sources[i];
+    if (!src->handler) continue;
+    syscalls += src->syscalls;
+    dlu_log_me(DLU_INFO, "  %-8s %" PRIu64 " wakeups, %" PRIu64 " syscalls", src->name, src->wakeups, src->syscalls);
+  }
+
+  if (loop->removed_wakeups || loop->removed_syscalls)
+    dlu_log_me(DLU_INFO, "  %-8s %" PRIu64 " wakeups, %" PRIu64 " syscalls", "removed", loop->removed_wakeups, loop->removed_syscalls);
+
+  dlu_log_me(DLU_INFO, "Event loop: %" PRIu64 " epoll_wait() calls, %" PRIu64 " syscalls in total", loop->waits, syscalls);
+  if (frames)
+    dlu_log_me(DLU_INFO, "  per frame: %.2f wakeups, %.2f syscalls", (double) loop->waits / frames, (double) syscalls / frames);
+}
+
+bool ev_drain_drm(ev_source *src, drmEventContext *ctx) {
+  _Alignas(struct drm_event_vblank) uint8_t buffer[4096];
+
+  /* Edge-triggered, so anything that lands between reads has to be picked up now */
+  while (1) {
+    ssize_t len = read(src->fd, buffer, sizeof(buffer));
+    src->syscalls++;
+
+    if (len == -1) {
+      if (errno == EAGAIN) return true;
+      if (errno == EINTR) continue;
+      dlu_log_me(DLU_DANGER, "[x] read: %s: %s", src->name, strerror(errno));
+      return false;
+    }
+
+    if (!len) return true;
+
+    for (size_t i = 0; i + sizeof(struct drm_event) <= (size_t) len; ) {
+      struct drm_event *e = (struct drm_event *) &buffer[i];
+
+      /* The kernel only hands out whole events, anything else means the rest of the read can't be trusted */
+      if (e->length < sizeof(struct drm_event) || e->length > (size_t) len - i) {
+        dlu_log_me(DLU_WARNING, "[x] %s: malformed DRM event (type %u, length %u), dropping the rest of the read", src->name, e->type, e->length);
+        break;
+      }
+
+      bool timed = e->type == DRM_EVENT_VBLANK || e->type == DRM_EVENT_FLIP_COMPLETE;
+      if (timed && e->length < sizeof(struct drm_event_vblank)) {
+        dlu_log_me(DLU_WARNING, "[x] %s: DRM event %u too short (%u bytes), skipped", src->name, e->type, e->length);
+        i += e->length;
+        continue;
+      }
+
+      struct drm_event_vblank *vblank = (struct drm_event_vblank *) e;
+      void *user_data = (timed) ? (void *) (uintptr_t) vblank->user_data : NULL;
+
+      switch (e->type) {
+        case DRM_EVENT_VBLANK:
+          if (ctx->vblank_handler)
+            ctx->vblank_handler(src->fd, vblank->sequence, vblank->tv_sec, vblank->tv_usec, user_data);
+          break;
+        case DRM_EVENT_FLIP_COMPLETE:
+          if (ctx->version >= 3 && ctx->page_flip_handler2)
+            ctx->page_flip_handler2(src->fd, vblank->sequence, vblank->tv_sec, vblank->tv_usec, vblank->crtc_id, user_data);
+          else if (ctx->page_flip_handler)
+            ctx->page_flip_handler(src->fd, vblank->sequence, vblank->tv_sec, vblank->tv_usec, user_data);
+          break;
+        default: break;
+      }
+
+      i += e->length;
+    }
+  }
+}
@@ -0,0 +1,91 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#ifndef EVLOOP_H
+#define EVLOOP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <xf86drm.h>
+
+/**
+* Edge-triggered epoll loop. Every fd gets its own handler, so nothing runs
+* for a source that didn't fire, and a handler must drain its source fully
+* because epoll won't report it again until new data arrives. The loop counts
+* wakeups and syscalls so they can be reported per frame.
+*/
+#define EV_LOOP_MAX_SOURCES 32
+
+typedef struct _ev_source ev_source;
+
+/* Return false to leave the loop */
+typedef bool (*ev_handler)(ev_source *src);
+
+struct _ev_source {
+  int fd;
+  const char *name;
+  ev_handler handler;
+  void *data;
+  uint64_t wakeups;
+  uint64_t syscalls; /* Made by the handler, bumped by the handler itself */
+};
+
+typedef struct _ev_loop {
+  int epfd;
+  ev_source sources[EV_LOOP_MAX_SOURCES];
+  uint32_t source_cnt;
+  uint64_t waits; /* epoll_wait() calls */
+  uint64_t removed_wakeups; /* Counts of sources that came and went */
+  uint64_t removed_syscalls;
+} ev_loop;
+
+bool ev_loop_init(ev_loop *loop);
+void ev_loop_fini(ev_loop *loop);
+
+/* Registers fd with EPOLLIN | EPOLLET and makes it non-blocking. Returns NULL on failure */
+ev_source *ev_loop_add(ev_loop *loop, int fd, const char *name, ev_handler handler, void *data);
+
+/* Unregisters a source, the fd stays open. Fine to call from the source's own handler */
+void ev_loop_remove(ev_loop *loop, ev_source *src);
+
+/**
+* Waits once and runs the handler of every source that fired. Returns false if
+* a handler asked to stop or epoll failed. A signal makes it return true with
+* nothing dispatched, so the caller can check its signal flags.
+*/
+bool ev_loop_dispatch(ev_loop *loop);
+
+/* frames is what the counts are divided by, 0 skips the per frame numbers */
+void ev_loop_report(const ev_loop *loop, uint64_t frames);
+
+/**
+* Reads and dispatches every pending DRM event on a non-blocking fd, like
+* drmHandleEvent() but until read() says EAGAIN, as the edge won't fire again
+* for events already queued. Each event's length is checked against the read
+* before any field is touched. Returns false on a read error.
+*/
+bool ev_drain_drm(ev_source *src, drmEventContext *ctx);
+
+#endif
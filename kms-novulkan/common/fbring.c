@@ -0,0 +1,124 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+
+#define LUCUR_DISPLAY_API
+#include <dluc/lucurious.h>
+
+#include "fbring.h"
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void fb_ring_init(fb_ring *ring, uint32_t count) {
+  memset(ring, 0, sizeof(fb_ring));
+
+  if (count < FB_RING_MIN) count = FB_RING_MIN;
+  if (count > FB_RING_MAX) count = FB_RING_MAX;
+
+  ring->count = count;
+  ring->flipping = -1;
+  ring->scanout = -1;
+}
+
+void fb_ring_scanout(fb_ring *ring, uint32_t idx) {
+  if (ring->scanout != -1) ring->state[ring->scanout] = FB_FREE;
+  ring->state[idx] = FB_SCANOUT;
+  ring->scanout = idx;
+  ring->next = (idx + 1) % ring->count;
+}
+
+int32_t fb_ring_acquire(fb_ring *ring) {
+  for (uint32_t i = 0; i < ring->count; i++) {
+    uint32_t idx = (ring->next + i) % ring->count;
+    if (ring->state[idx] != FB_FREE) continue;
+
+    ring->state[idx] = FB_RENDERING;
+    ring->next = (idx + 1) % ring->count;
+    return idx;
+  }
+
+  return -1;
+}
+
+void fb_ring_queue(fb_ring *ring, uint32_t idx) {
+  ring->state[idx] = FB_QUEUED;
+  ring->queued_at[idx] = now_seconds();
+  ring->queue[ring->queue_len++] = idx;
+}
+
+int32_t fb_ring_flip(fb_ring *ring) {
+  if (ring->flipping != -1 || !ring->queue_len) return -1;
+
+  uint32_t idx = ring->queue[0];
+  memmove(ring->queue, ring->queue + 1, --ring->queue_len * sizeof(uint32_t));
+
+  ring->state[idx] = FB_FLIPPING;
+  ring->flipping = idx;
+  return idx;
+}
+
+void fb_ring_cancel(fb_ring *ring, uint32_t idx) {
+  memmove(ring->queue + 1, ring->queue, ring->queue_len++ * sizeof(uint32_t));
+  ring->queue[0] = idx;
+  ring->state[idx] = FB_QUEUED;
+  ring->flipping = -1;
+}
+
+void fb_ring_flipped(fb_ring *ring, uint32_t tv_sec, uint32_t tv_usec) {
+  if (ring->flipping == -1) return;
+
+  /* The kernel timestamps flip events with CLOCK_MONOTONIC */
+  double latency = (tv_sec + tv_usec * 1e-6) - ring->queued_at[ring->flipping];
+  if (latency > 0) {
+    ring->latency_sum += latency;
+    if (latency > ring->latency_max) ring->latency_max = latency;
+  }
+
+  ring->flips++;
+
+  if (ring->scanout != -1) ring->state[ring->scanout] = FB_FREE;
+  ring->state[ring->flipping] = FB_SCANOUT;
+  ring->scanout = ring->flipping;
+  ring->flipping = -1;
+}
+
+void fb_ring_report(const fb_ring *ring, const flip_rec *flips) {
+  flip_stats stats;
+
+  if (!ring->flips) return;
+  if (!flip_rec_stats(flips, &stats)) stats.skipped = 0;
+
+  dlu_log_me(DLU_INFO, "%u buffers: %" PRIu64 " flips, %" PRIu64 " missed vblanks, latency avg %.2f ms, max %.2f ms",
+             ring->count, ring->flips, stats.skipped, ring->latency_sum / ring->flips * 1e3, ring->latency_max * 1e3);
+}
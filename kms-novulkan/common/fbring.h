@@ -0,0 +1,91 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#ifndef FBRING_H
+#define FBRING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "fliprec.h"
+
+/**
+* Tracks what every scanout buffer is doing so drawing can run ahead of vblank.
+* A buffer goes free -> rendering -> queued -> flipping -> scanout -> free.
+* Only one flip is ever in flight, the rest of the finished frames wait in
+* order. With two buffers this is plain double buffering, each extra buffer
+* lets the renderer get one more frame ahead (and adds a frame of latency).
+*/
+#define FB_RING_MIN 2
+#define FB_RING_MAX 4
+
+typedef enum _fb_state {
+  FB_FREE = 0,
+  FB_RENDERING = 1,
+  FB_QUEUED = 2,   /* Finished, waiting for its turn to flip */
+  FB_FLIPPING = 3, /* Handed to the kernel, flips on the next vblank */
+  FB_SCANOUT = 4
+} fb_state;
+
+typedef struct _fb_ring {
+  uint32_t count;
+  fb_state state[FB_RING_MAX];
+  double queued_at[FB_RING_MAX]; /* CLOCK_MONOTONIC seconds when rendering finished */
+
+  uint32_t next; /* Buffers are handed out round robin starting here */
+  uint32_t queue[FB_RING_MAX]; /* Finished buffers, oldest first */
+  uint32_t queue_len;
+  int32_t flipping;
+  int32_t scanout;
+
+  /* Stats, skipped vblanks are flip_rec's to count */
+  uint64_t flips;
+  double latency_sum; /* From finishing a frame to it hitting the screen */
+  double latency_max;
+} fb_ring;
+
+void fb_ring_init(fb_ring *ring, uint32_t count);
+
+/* idx is already on screen, e.g. the modeset put it there. It's left alone until the first flip replaces it */
+void fb_ring_scanout(fb_ring *ring, uint32_t idx);
+
+/* A free buffer to draw into (now rendering), or -1 if every buffer is busy */
+int32_t fb_ring_acquire(fb_ring *ring);
+
+/* Drawing into idx is done */
+void fb_ring_queue(fb_ring *ring, uint32_t idx);
+
+/* Oldest queued buffer to flip to, or -1 if there's none or a flip is still in flight */
+int32_t fb_ring_flip(fb_ring *ring);
+
+/* The flip couldn't be submitted, idx goes back to the front of the queue */
+void fb_ring_cancel(fb_ring *ring, uint32_t idx);
+
+/* The in-flight flip completed, tv_sec/tv_usec as passed to the DRM event handler */
+void fb_ring_flipped(fb_ring *ring, uint32_t tv_sec, uint32_t tv_usec);
+
+/* Latency for this depth, with the skipped vblanks out of the output's flip record */
+void fb_ring_report(const fb_ring *ring, const flip_rec *flips);
+
+#endif
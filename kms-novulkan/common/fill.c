@@ -0,0 +1,323 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define FILL_HAVE_X86
+#include <immintrin.h>
+#endif
+
+#include "fill.h"
+
+typedef void (*fill_row_fn)(uint32_t *row, uint32_t pixel, uint32_t width);
+
+static void fill_row32_resolve(uint32_t *row, uint32_t pixel, uint32_t width);
+
+static fill_row_fn fill_row_impl = fill_row32_resolve;
+static fill_kernel cur_kernel = FILL_KERNEL_AUTO;
+
+static const char *kernel_names[FILL_KERNEL_MAX] = {
+  "auto", "scalar", "sse2", "avx2", "avx512", "sse2-nt", "avx2-nt"
+};
+
+/* Portable fallback, also used for the unaligned head and tail of the SIMD kernels */
+static void fill_row32_scalar(uint32_t *row, uint32_t pixel, uint32_t width) {
+  uint32_t *end = row + width;
+  while (row < end) *row++ = pixel;
+}
+
+#ifdef FILL_HAVE_X86
+__attribute__((target("sse2")))
+static void fill_row32_sse2(uint32_t *row, uint32_t pixel, uint32_t width) {
+  const __m128i v = _mm_set1_epi32((int) pixel);
+
+  /* BO rows are 4 byte aligned, walk forward until they're 16 byte aligned */
+  while (width && ((uintptr_t) row & 15)) { *row++ = pixel; width--; }
+
+  for (; width >= 16; width -= 16, row += 16) {
+    _mm_store_si128((__m128i *) row + 0, v);
+    _mm_store_si128((__m128i *) row + 1, v);
+    _mm_store_si128((__m128i *) row + 2, v);
+    _mm_store_si128((__m128i *) row + 3, v);
+  }
+
+  for (; width >= 4; width -= 4, row += 4)
+    _mm_store_si128((__m128i *) row, v);
+
+  fill_row32_scalar(row, pixel, width);
+}
+
+__attribute__((target("avx2")))
+static void fill_row32_avx2(uint32_t *row, uint32_t pixel, uint32_t width) {
+  const __m256i v = _mm256_set1_epi32((int) pixel);
+
+  while (width && ((uintptr_t) row & 31)) { *row++ = pixel; width--; }
+
+  for (; width >= 32; width -= 32, row += 32) {
+    _mm256_store_si256((__m256i *) row + 0, v);
+    _mm256_store_si256((__m256i *) row + 1, v);
+    _mm256_store_si256((__m256i *) row + 2, v);
+    _mm256_store_si256((__m256i *) row + 3, v);
+  }
+
+  for (; width >= 8; width -= 8, row += 8)
+    _mm256_store_si256((__m256i *) row, v);
+
+  fill_row32_scalar(row, pixel, width);
+}
+
+__attribute__((target("avx512f")))
+static void fill_row32_avx512(uint32_t *row, uint32_t pixel, uint32_t width) {
+  const __m512i v = _mm512_set1_epi32((int) pixel);
+
+  /* Masked stores take care of both the head and the tail in one instruction */
+  uint32_t head = (uint32_t) ((64 - ((uintptr_t) row & 63)) & 63) / 4;
+  if (head > width) head = width;
+  if (head) {
+    _mm512_mask_storeu_epi32(row, (__mmask16) ((1u << head) - 1), v);
+    row += head; width -= head;
+  }
+
+  for (; width >= 64; width -= 64, row += 64) {
+    _mm512_store_si512((__m512i *) row + 0, v);
+    _mm512_store_si512((__m512i *) row + 1, v);
+    _mm512_store_si512((__m512i *) row + 2, v);
+    _mm512_store_si512((__m512i *) row + 3, v);
+  }
+
+  for (; width >= 16; width -= 16, row += 16)
+    _mm512_store_si512((__m512i *) row, v);
+
+  if (width)
+    _mm512_mask_storeu_epi32(row, (__mmask16) ((1u << width) - 1), v);
+}
+
+/**
+* Streaming variants: the stores go around the cache straight to memory, so a
+* frame written into a write-combined scanout mapping doesn't evict the working
+* set. Callers fence once per rectangle with _mm_sfence(), not per row.
+*/
+__attribute__((target("sse2")))
+static void fill_row32_sse2_nt(uint32_t *row, uint32_t pixel, uint32_t width) {
+  const __m128i v = _mm_set1_epi32((int) pixel);
+
+  while (width && ((uintptr_t) row & 15)) { *row++ = pixel; width--; }
+
+  for (; width >= 16; width -= 16, row += 16) {
+    _mm_stream_si128((__m128i *) row + 0, v);
+    _mm_stream_si128((__m128i *) row + 1, v);
+    _mm_stream_si128((__m128i *) row + 2, v);
+    _mm_stream_si128((__m128i *) row + 3, v);
+  }
+
+  for (; width >= 4; width -= 4, row += 4)
+    _mm_stream_si128((__m128i *) row, v);
+
+  fill_row32_scalar(row, pixel, width);
+}
+
+__attribute__((target("avx2")))
+static void fill_row32_avx2_nt(uint32_t *row, uint32_t pixel, uint32_t width) {
+  const __m256i v = _mm256_set1_epi32((int) pixel);
+
+  while (width && ((uintptr_t) row & 31)) { *row++ = pixel; width--; }
+
+  for (; width >= 32; width -= 32, row += 32) {
+    _mm256_stream_si256((__m256i *) row + 0, v);
+    _mm256_stream_si256((__m256i *) row + 1, v);
+    _mm256_stream_si256((__m256i *) row + 2, v);
+    _mm256_stream_si256((__m256i *) row + 3, v);
+  }
+
+  for (; width >= 8; width -= 8, row += 8)
+    _mm256_stream_si256((__m256i *) row, v);
+
+  fill_row32_scalar(row, pixel, width);
+}
+
+/* Same idea for copies, src only needs to be 4 byte aligned */
+__attribute__((target("sse2")))
+static void copy_row_sse2_nt(uint8_t *dst, const uint8_t *src, size_t bytes) {
+  while (bytes && ((uintptr_t) dst & 15)) { *dst++ = *src++; bytes--; }
+
+  for (; bytes >= 64; bytes -= 64, dst += 64, src += 64) {
+    __m128i a = _mm_loadu_si128((const __m128i *) src + 0);
+    __m128i b = _mm_loadu_si128((const __m128i *) src + 1);
+    __m128i c = _mm_loadu_si128((const __m128i *) src + 2);
+    __m128i d = _mm_loadu_si128((const __m128i *) src + 3);
+    _mm_stream_si128((__m128i *) dst + 0, a);
+    _mm_stream_si128((__m128i *) dst + 1, b);
+    _mm_stream_si128((__m128i *) dst + 2, c);
+    _mm_stream_si128((__m128i *) dst + 3, d);
+  }
+
+  memcpy(dst, src, bytes);
+}
+
+__attribute__((target("avx2")))
+static void copy_row_avx2_nt(uint8_t *dst, const uint8_t *src, size_t bytes) {
+  while (bytes && ((uintptr_t) dst & 31)) { *dst++ = *src++; bytes--; }
+
+  for (; bytes >= 128; bytes -= 128, dst += 128, src += 128) {
+    __m256i a = _mm256_loadu_si256((const __m256i *) src + 0);
+    __m256i b = _mm256_loadu_si256((const __m256i *) src + 1);
+    __m256i c = _mm256_loadu_si256((const __m256i *) src + 2);
+    __m256i d = _mm256_loadu_si256((const __m256i *) src + 3);
+    _mm256_stream_si256((__m256i *) dst + 0, a);
+    _mm256_stream_si256((__m256i *) dst + 1, b);
+    _mm256_stream_si256((__m256i *) dst + 2, c);
+    _mm256_stream_si256((__m256i *) dst + 3, d);
+  }
+
+  memcpy(dst, src, bytes);
+}
+#endif
+
+static fill_row_fn kernel_fn(fill_kernel kernel) {
+  switch (kernel) {
+#ifdef FILL_HAVE_X86
+    case FILL_KERNEL_SSE2: return fill_row32_sse2;
+    case FILL_KERNEL_AVX2: return fill_row32_avx2;
+    case FILL_KERNEL_AVX512: return fill_row32_avx512;
+    case FILL_KERNEL_SSE2_NT: return fill_row32_sse2_nt;
+    case FILL_KERNEL_AVX2_NT: return fill_row32_avx2_nt;
+#endif
+    default: return fill_row32_scalar;
+  }
+}
+
+bool fill_kernel_supported(fill_kernel kernel) {
+  switch (kernel) {
+    case FILL_KERNEL_AUTO: return true;
+    case FILL_KERNEL_SCALAR: return true;
+#ifdef FILL_HAVE_X86
+    case FILL_KERNEL_SSE2: return __builtin_cpu_supports("sse2");
+    case FILL_KERNEL_AVX2: return __builtin_cpu_supports("avx2");
+    case FILL_KERNEL_AVX512: return __builtin_cpu_supports("avx512f");
+    case FILL_KERNEL_SSE2_NT: return __builtin_cpu_supports("sse2");
+    case FILL_KERNEL_AVX2_NT: return __builtin_cpu_supports("avx2");
+#endif
+    default: return false;
+  }
+}
+
+static fill_kernel detect_kernel(void) {
+#ifdef FILL_HAVE_X86
+  __builtin_cpu_init();
+#endif
+  /* Streaming kernels only pay off on uncached memory, they're never picked on their own */
+  for (fill_kernel k = FILL_KERNEL_AVX512; k > FILL_KERNEL_SCALAR; k--)
+    if (fill_kernel_supported(k)) return k;
+  return FILL_KERNEL_SCALAR;
+}
+
+bool fill_set_kernel(fill_kernel kernel) {
+  if (kernel >= FILL_KERNEL_MAX || !fill_kernel_supported(kernel)) return false;
+  if (kernel == FILL_KERNEL_AUTO) kernel = detect_kernel();
+
+  fill_row_impl = kernel_fn(kernel);
+  cur_kernel = kernel;
+
+  return true;
+}
+
+fill_kernel fill_get_kernel(void) {
+  if (cur_kernel == FILL_KERNEL_AUTO) fill_set_kernel(FILL_KERNEL_AUTO);
+  return cur_kernel;
+}
+
+bool fill_kernel_streams(fill_kernel kernel) {
+  return kernel == FILL_KERNEL_SSE2_NT || kernel == FILL_KERNEL_AVX2_NT;
+}
+
+fill_kernel fill_stream_kernel(void) {
+#ifdef FILL_HAVE_X86
+  __builtin_cpu_init();
+#endif
+  if (fill_kernel_supported(FILL_KERNEL_AVX2_NT)) return FILL_KERNEL_AVX2_NT;
+  if (fill_kernel_supported(FILL_KERNEL_SSE2_NT)) return FILL_KERNEL_SSE2_NT;
+  return FILL_KERNEL_AUTO;
+}
+
+const char *fill_kernel_name(fill_kernel kernel) {
+  return (kernel < FILL_KERNEL_MAX) ? kernel_names[kernel] : "unknown";
+}
+
+/* First call lands here, picks a kernel and forwards */
+static void fill_row32_resolve(uint32_t *row, uint32_t pixel, uint32_t width) {
+  fill_set_kernel(FILL_KERNEL_AUTO);
+  fill_row_impl(row, pixel, width);
+}
+
+void fill_row32(uint32_t *row, uint32_t pixel, uint32_t width) {
+  fill_row_impl(row, pixel, width);
+}
+
+static void fill_fence(void) {
+#ifdef FILL_HAVE_X86
+  /* Streaming stores are weakly ordered, drain them before anyone else looks */
+  if (fill_kernel_streams(cur_kernel)) _mm_sfence();
+#endif
+}
+
+void fill_rect32(uint8_t *base, uint32_t pitch, uint32_t width, uint32_t height, uint32_t pixel) {
+  /* No padding between rows means the whole rectangle is one long scanline */
+  if ((size_t) pitch == (size_t) width * 4 && (size_t) width * height <= UINT32_MAX) {
+    fill_row_impl((uint32_t *) base, pixel, width * height);
+    fill_fence();
+    return;
+  }
+
+  for (uint32_t j = 0; j < height; j++)
+    fill_row_impl((uint32_t *) (base + (size_t) pitch * j), pixel, width);
+  fill_fence();
+}
+
+void fill_copy_rows(uint8_t *dst, uint32_t dst_pitch, const uint8_t *src, uint32_t src_pitch, uint32_t row_bytes, uint32_t rows) {
+  void (*copy_row)(uint8_t *, const uint8_t *, size_t) = NULL;
+
+#ifdef FILL_HAVE_X86
+  if (cur_kernel == FILL_KERNEL_SSE2_NT) copy_row = copy_row_sse2_nt;
+  if (cur_kernel == FILL_KERNEL_AVX2_NT) copy_row = copy_row_avx2_nt;
+#endif
+
+  if (!copy_row) {
+    if (src_pitch == dst_pitch && row_bytes == dst_pitch) {
+      memcpy(dst, src, (size_t) dst_pitch * rows);
+      return;
+    }
+
+    for (uint32_t j = 0; j < rows; j++)
+      memcpy(dst + (size_t) dst_pitch * j, src + (size_t) src_pitch * j, row_bytes);
+    return;
+  }
+
+  for (uint32_t j = 0; j < rows; j++)
+    copy_row(dst + (size_t) dst_pitch * j, src + (size_t) src_pitch * j, row_bytes);
+  fill_fence();
+}
@@ -0,0 +1,80 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#ifndef FILL_H
+#define FILL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+* Solid color fill for 32 bit per pixel framebuffers. Every kernel writes
+* whole scanlines and steps through the buffer by its pitch, so padding
+* bytes at the end of a row are never touched. The fastest kernel the CPU
+* supports is picked the first time a fill is requested.
+*/
+typedef enum _fill_kernel {
+  FILL_KERNEL_AUTO = 0,
+  FILL_KERNEL_SCALAR,
+  FILL_KERNEL_SSE2,
+  FILL_KERNEL_AVX2,
+  FILL_KERNEL_AVX512,
+  FILL_KERNEL_SSE2_NT, /* Non-temporal stores, for write-combined mappings like dumb buffers */
+  FILL_KERNEL_AVX2_NT,
+  FILL_KERNEL_MAX
+} fill_kernel;
+
+/* Returns true if the running CPU can execute kernel */
+bool fill_kernel_supported(fill_kernel kernel);
+
+/**
+* Force a specific kernel. FILL_KERNEL_AUTO goes back to runtime detection.
+* Returns false and leaves the current kernel alone if it isn't supported.
+*/
+bool fill_set_kernel(fill_kernel kernel);
+
+/* Kernel currently in use, after any detection has happened */
+fill_kernel fill_get_kernel(void);
+
+/* True for the kernels that bypass the cache with non-temporal stores */
+bool fill_kernel_streams(fill_kernel kernel);
+
+/* Best streaming kernel the CPU supports, FILL_KERNEL_AUTO if there's none */
+fill_kernel fill_stream_kernel(void);
+
+const char *fill_kernel_name(fill_kernel kernel);
+
+/* Write width copies of pixel starting at row */
+void fill_row32(uint32_t *row, uint32_t pixel, uint32_t width);
+
+/* Fill a width x height rectangle whose rows are pitch bytes apart */
+void fill_rect32(uint8_t *base, uint32_t pitch, uint32_t width, uint32_t height, uint32_t pixel);
+
+/**
+* Copy rows of row_bytes from src into dst. Uses streaming stores when the
+* current kernel does, plain memcpy otherwise.
+*/
+void fill_copy_rows(uint8_t *dst, uint32_t dst_pitch, const uint8_t *src, uint32_t src_pitch, uint32_t row_bytes, uint32_t rows);
+
+#endif
@@ -0,0 +1,229 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "fill.h"
+#include "fillpool.h"
+
+typedef struct _fill_job {
+  uint8_t *base;
+  uint32_t pitch;
+  uint32_t width;
+  uint32_t height;
+  uint32_t pixel;
+} fill_job;
+
+typedef struct _fill_worker {
+  fill_pool *pool;
+  pthread_t thread;
+  uint32_t band;
+} fill_worker;
+
+struct _fill_pool {
+  pthread_mutex_t lock;
+  pthread_cond_t start;
+  pthread_cond_t done;
+
+  fill_worker *workers;
+  uint32_t thread_cnt; /* Workers plus the calling thread */
+  uint32_t worker_cnt; /* Workers that were actually started */
+
+  uint64_t generation;
+  uint32_t pending;
+  bool quit;
+  fill_job job;
+};
+
+static void fill_band(const fill_job *job, uint32_t band, uint32_t bands) {
+  uint32_t first = (uint64_t) job->height * band / bands;
+  uint32_t last = (uint64_t) job->height * (band + 1) / bands;
+
+  if (first == last) return;
+  fill_rect32(job->base + (size_t) job->pitch * first, job->pitch, job->width, last - first, job->pixel);
+}
+
+static void *worker_main(void *data) {
+  fill_worker *worker = (fill_worker *) data;
+  fill_pool *pool = worker->pool;
+  uint64_t seen = 0;
+  fill_job job;
+
+  pthread_mutex_lock(&pool->lock);
+  while (1) {
+    while (!pool->quit && pool->generation == seen)
+      pthread_cond_wait(&pool->start, &pool->lock);
+    if (pool->quit) break;
+
+    seen = pool->generation;
+    job = pool->job;
+    pthread_mutex_unlock(&pool->lock);
+
+    fill_band(&job, worker->band, pool->thread_cnt);
+
+    pthread_mutex_lock(&pool->lock);
+    if (--pool->pending == 0) pthread_cond_signal(&pool->done);
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  return NULL;
+}
+
+/* Spread workers over the CPUs we're allowed to run on, leaving the first one to the caller */
+static void pin_worker(fill_worker *worker, const cpu_set_t *allowed) {
+  uint32_t cpu_cnt = CPU_COUNT(allowed), nth = 0;
+  if (!cpu_cnt) return;
+
+  nth = worker->band % cpu_cnt;
+  for (uint32_t cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+    if (!CPU_ISSET(cpu, allowed)) continue;
+    if (nth--) continue;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(worker->thread, sizeof(set), &set);
+    return;
+  }
+}
+
+bool fill_pool_parse_threads(const char *arg, uint32_t *threads) {
+  char *end = NULL;
+
+  if (!isdigit((unsigned char) *arg)) return false; /* strtoul() would take "-1" and " 2" */
+
+  errno = 0;
+  unsigned long value = strtoul(arg, &end, 10);
+  if (errno || *end || value > UINT32_MAX) return false;
+
+  *threads = (uint32_t) value;
+  return true;
+}
+
+fill_pool *fill_pool_create(uint32_t threads) {
+  cpu_set_t allowed;
+  int err = 0;
+
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) == -1)
+    CPU_ZERO(&allowed);
+
+  uint32_t max = CPU_COUNT(&allowed);
+  if (!max) max = FILL_POOL_MAX_THREADS;
+
+  if (!threads) threads = max;
+  if (threads > max) {
+    fprintf(stderr, "%u fill threads asked for but only %u CPUs to run them on, using %u\n", threads, max, max);
+    threads = max;
+  }
+
+  /* Resolve the fill kernel now rather than racing on it from every worker */
+  fill_get_kernel();
+
+  fill_pool *pool = calloc(1, sizeof(fill_pool));
+  if (!pool) { fprintf(stderr, "[x] calloc: %s\n", strerror(errno)); return NULL; }
+
+  pool->thread_cnt = threads;
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->start, NULL);
+  pthread_cond_init(&pool->done, NULL);
+
+  if (threads == 1) return pool;
+
+  pool->workers = calloc(threads - 1, sizeof(fill_worker));
+  if (!pool->workers) { fprintf(stderr, "[x] calloc: %s\n", strerror(errno)); goto err_destroy; }
+
+  for (uint32_t i = 0; i < threads - 1; i++) {
+    pool->workers[i].pool = pool;
+    pool->workers[i].band = i + 1;
+
+    err = pthread_create(&pool->workers[i].thread, NULL, worker_main, &pool->workers[i]);
+    if (err) { fprintf(stderr, "[x] pthread_create: %s\n", strerror(err)); goto err_destroy; }
+
+    pool->worker_cnt++;
+    pin_worker(&pool->workers[i], &allowed);
+  }
+
+  return pool;
+
+err_destroy:
+  fill_pool_destroy(pool);
+  return NULL;
+}
+
+void fill_pool_destroy(fill_pool *pool) {
+  if (!pool) return;
+
+  pthread_mutex_lock(&pool->lock);
+  pool->quit = true;
+  pthread_cond_broadcast(&pool->start);
+  pthread_mutex_unlock(&pool->lock);
+
+  for (uint32_t i = 0; i < pool->worker_cnt; i++)
+    pthread_join(pool->workers[i].thread, NULL);
+
+  pthread_cond_destroy(&pool->done);
+  pthread_cond_destroy(&pool->start);
+  pthread_mutex_destroy(&pool->lock);
+  free(pool->workers);
+  free(pool);
+}
+
+uint32_t fill_pool_threads(fill_pool *pool) {
+  return (pool) ? pool->thread_cnt : 1;
+}
+
+void fill_pool_rect32(fill_pool *pool, uint8_t *base, uint32_t pitch, uint32_t width, uint32_t height, uint32_t pixel) {
+  if (!pool || pool->thread_cnt < 2 || height < pool->thread_cnt) {
+    fill_rect32(base, pitch, width, height, pixel);
+    return;
+  }
+
+  fill_job job = { .base = base, .pitch = pitch, .width = width, .height = height, .pixel = pixel };
+
+  pthread_mutex_lock(&pool->lock);
+  pool->job = job;
+  pool->pending = pool->thread_cnt - 1;
+  pool->generation++;
+  pthread_cond_broadcast(&pool->start);
+  pthread_mutex_unlock(&pool->lock);
+
+  fill_band(&job, 0, pool->thread_cnt);
+
+  /* Barrier, nothing may be flipped until every band has landed */
+  pthread_mutex_lock(&pool->lock);
+  while (pool->pending)
+    pthread_cond_wait(&pool->done, &pool->lock);
+  pthread_mutex_unlock(&pool->lock);
+}
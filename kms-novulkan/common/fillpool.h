@@ -0,0 +1,58 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#ifndef FILLPOOL_H
+#define FILLPOOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+* Persistent pool of pinned worker threads that split a fill into horizontal
+* bands. The calling thread takes the first band itself and fill_pool_rect32()
+* only returns once every band is written, so it is safe to queue the flip
+* right after it.
+*/
+typedef struct _fill_pool fill_pool;
+
+/* Most threads a pool runs when the affinity mask can't be read */
+#define FILL_POOL_MAX_THREADS 64
+
+/**
+* threads counts the calling thread, 0 means one per CPU the process may run on.
+* More than that is clamped, the workers are pinned and would only share CPUs.
+* Returns NULL on failure
+*/
+fill_pool *fill_pool_create(uint32_t threads);
+
+/* Parses a -t style thread count. False unless arg is a plain decimal number */
+bool fill_pool_parse_threads(const char *arg, uint32_t *threads);
+void fill_pool_destroy(fill_pool *pool);
+
+uint32_t fill_pool_threads(fill_pool *pool);
+
+/* Same contract as fill_rect32(), a NULL pool fills on the calling thread */
+void fill_pool_rect32(fill_pool *pool, uint8_t *base, uint32_t pitch, uint32_t width, uint32_t height, uint32_t pixel);
+
+#endif
@@ -0,0 +1,138 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+
+#define LUCUR_DISPLAY_API
+#include <dluc/lucurious.h>
+
+#include "fliprec.h"
+
+#define FLIP_REC_MASK (FLIP_REC_SIZE - 1)
+
+/* Upper bounds of the jitter buckets in ms */
+const double flip_jitter_bounds[FLIP_JITTER_BUCKETS - 1] = { 0.05, 0.1, 0.25, 0.5, 1.0, 2.0, 4.0 };
+
+void flip_rec_add(flip_rec *rec, uint32_t sequence, uint32_t tv_sec, uint32_t tv_usec) {
+  uint64_t slot = rec->count++ & FLIP_REC_MASK;
+  rec->seq[slot] = sequence;
+  rec->usec[slot] = (uint64_t) tv_sec * 1000000 + tv_usec;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+  double x = *(const double *) a, y = *(const double *) b;
+  return (x > y) - (x < y);
+}
+
+static double percentile(const double *sorted, uint32_t count, double p) {
+  uint32_t idx = (uint32_t) (p * (count - 1) + 0.5);
+  return sorted[idx];
+}
+
+bool flip_rec_stats(const flip_rec *rec, flip_stats *stats) {
+  uint64_t kept = (rec->count < FLIP_REC_SIZE) ? rec->count : FLIP_REC_SIZE;
+
+  memset(stats, 0, sizeof(flip_stats));
+  stats->count = rec->count;
+  stats->kept = kept;
+  if (kept < 2) return false;
+
+  uint32_t interval_cnt = kept - 1, single_cnt = 0;
+  uint64_t first = rec->count - kept;
+
+  double *intervals = calloc(interval_cnt * 2, sizeof(double));
+  if (!intervals) { dlu_log_me(DLU_DANGER, "[x] calloc: %s", strerror(errno)); return false; }
+  double *single = intervals + interval_cnt; /* Intervals that spanned exactly one vblank */
+  uint32_t *spans = calloc(interval_cnt, sizeof(uint32_t));
+  if (!spans) { dlu_log_me(DLU_DANGER, "[x] calloc: %s", strerror(errno)); free(intervals); return false; }
+
+  for (uint32_t i = 0; i < interval_cnt; i++) {
+    uint64_t a = (first + i) & FLIP_REC_MASK, b = (first + i + 1) & FLIP_REC_MASK;
+
+    intervals[i] = (rec->usec[b] - rec->usec[a]) * 1e-3;
+
+    /* Unsigned difference copes with the counter wrapping */
+    spans[i] = rec->seq[b] - rec->seq[a];
+    if (spans[i] > 1 && spans[i] < UINT32_MAX / 2) stats->skipped += spans[i] - 1;
+    if (spans[i] == 1) single[single_cnt++] = intervals[i];
+  }
+
+  /* The refresh period is whatever a one vblank interval usually takes */
+  qsort(single, single_cnt, sizeof(double), compare_doubles);
+  stats->period = (single_cnt) ? percentile(single, single_cnt, 0.5) : 0;
+
+  for (uint32_t i = 0; i < interval_cnt && stats->period > 0; i++) {
+    uint32_t span = (spans[i] && spans[i] < UINT32_MAX / 2) ? spans[i] : 1;
+    double jitter = intervals[i] - stats->period * span;
+    if (jitter < 0) jitter = -jitter;
+
+    uint32_t b = 0;
+    while (b < FLIP_JITTER_BUCKETS - 1 && jitter >= flip_jitter_bounds[b]) b++;
+    stats->jitter[b]++;
+  }
+
+  qsort(intervals, interval_cnt, sizeof(double), compare_doubles);
+  stats->min = intervals[0];
+  stats->p50 = percentile(intervals, interval_cnt, 0.5);
+  stats->p90 = percentile(intervals, interval_cnt, 0.9);
+  stats->p99 = percentile(intervals, interval_cnt, 0.99);
+  stats->p999 = percentile(intervals, interval_cnt, 0.999);
+  stats->max = intervals[interval_cnt - 1];
+
+  free(spans);
+  free(intervals);
+  return true;
+}
+
+void flip_rec_report(const flip_rec *rec) {
+  flip_stats stats;
+  if (!flip_rec_stats(rec, &stats)) return;
+
+  uint64_t interval_cnt = stats.kept - 1;
+
+  dlu_log_me(DLU_INFO, "Flips: %" PRIu64 " recorded, last %" PRIu64 " analysed, %" PRIu64 " vblank sequences skipped",
+             stats.count, stats.kept, stats.skipped);
+  dlu_log_me(DLU_INFO, "Frame interval ms: min %.3f p50 %.3f p90 %.3f p99 %.3f p99.9 %.3f max %.3f",
+             stats.min, stats.p50, stats.p90, stats.p99, stats.p999, stats.max);
+
+  if (stats.period > 0) {
+    dlu_log_me(DLU_INFO, "Jitter against a %.3f ms refresh period:", stats.period);
+
+    for (uint32_t b = 0; b < FLIP_JITTER_BUCKETS; b++) {
+      char bar[41];
+      uint32_t len = stats.jitter[b] * 40 / interval_cnt;
+      memset(bar, '#', len); bar[len] = '\0';
+
+      if (b < FLIP_JITTER_BUCKETS - 1)
+        dlu_log_me(DLU_INFO, "  < %5.2f ms %8" PRIu64 " %s", flip_jitter_bounds[b], stats.jitter[b], bar);
+      else
+        dlu_log_me(DLU_INFO, " >= %5.2f ms %8" PRIu64 " %s", flip_jitter_bounds[b - 1], stats.jitter[b], bar);
+    }
+  }
+}
@@ -0,0 +1,71 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#ifndef FLIPREC_H
+#define FLIPREC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+* Records every page-flip completion (vblank sequence + timestamp) into a fixed
+* ring. flip_rec_add() is cheap enough for the flip handler: no allocation, no
+* syscalls. flip_rec_report() does the sorting and printing, call it on exit.
+* Only the last FLIP_REC_SIZE flips are kept.
+*/
+#define FLIP_REC_SIZE 8192 /* Power of two, a bit over two minutes at 60Hz */
+
+typedef struct _flip_rec {
+  uint32_t seq[FLIP_REC_SIZE];
+  uint64_t usec[FLIP_REC_SIZE];
+  uint64_t count; /* Flips recorded in total, the newest is at (count - 1) % FLIP_REC_SIZE */
+} flip_rec;
+
+/* Jitter histogram buckets, the last one catches everything above the last bound */
+#define FLIP_JITTER_BUCKETS 8
+extern const double flip_jitter_bounds[FLIP_JITTER_BUCKETS - 1];
+
+/* What flip_rec_report() prints, for callers that want the numbers */
+typedef struct _flip_stats {
+  uint64_t count; /* Flips recorded in total */
+  uint64_t kept; /* The ones still in the ring, the rest are from the last kept flips */
+  uint64_t skipped; /* Vblank sequences that went by without a new frame */
+  double min, p50, p90, p99, p999, max; /* Frame interval, ms */
+  double period; /* Refresh period in ms, 0 if no interval spanned exactly one vblank */
+  uint64_t jitter[FLIP_JITTER_BUCKETS];
+} flip_stats;
+
+void flip_rec_add(flip_rec *rec, uint32_t sequence, uint32_t tv_sec, uint32_t tv_usec);
+
+/* Returns false if fewer than two flips were recorded, there are no intervals then */
+bool flip_rec_stats(const flip_rec *rec, flip_stats *stats);
+
+/**
+* Logs frame interval percentiles, how many vblank sequence numbers were skipped
+* (vblanks that went by without a new frame) and a histogram of jitter, the
+* difference between each interval and the refresh period times the vblanks it spanned.
+*/
+void flip_rec_report(const flip_rec *rec);
+
+#endif
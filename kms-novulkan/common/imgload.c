@@ -0,0 +1,402 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <ctype.h>
+#include <setjmp.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <png.h>
+#include <jpeglib.h>
+
+#define LUCUR_STBI_API
+#include <dluc/lucurious.h>
+
+#include "convert.h"
+#include "imgload.h"
+
+/* Header of a netpbm file whose pixels can be read in place */
+typedef struct _pnm_info {
+  uint32_t width;
+  uint32_t height;
+  uint32_t depth; /* 3 = RGB, 4 = RGB_ALPHA */
+  size_t offset;  /* Where the first row starts */
+} pnm_info;
+
+bool img_file_map(img_file *file, const char *path) {
+  struct stat st;
+  bool ret = false;
+
+  memset(file, 0, sizeof(img_file));
+
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd == -1) { dlu_log_me(DLU_DANGER, "[x] open: %s: %s", path, strerror(errno)); return false; }
+
+  if (fstat(fd, &st) == -1) { dlu_log_me(DLU_DANGER, "[x] fstat: %s", strerror(errno)); goto exit_map; }
+  if (!st.st_size) { dlu_log_me(DLU_DANGER, "[x] %s is empty", path); goto exit_map; }
+
+  file->bytes = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (file->bytes == MAP_FAILED) {
+    dlu_log_me(DLU_DANGER, "[x] mmap: %s", strerror(errno));
+    file->bytes = NULL;
+    goto exit_map;
+  }
+
+  file->size = st.st_size;
+
+  /* Decoders walk the file front to back exactly once */
+  madvise(file->bytes, file->size, MADV_SEQUENTIAL);
+  ret = true;
+
+exit_map:
+  close(fd); /* The mapping keeps its own reference */
+  return ret;
+}
+
+void img_file_unmap(img_file *file) {
+  if (file->bytes) munmap(file->bytes, file->size);
+  memset(file, 0, sizeof(img_file));
+}
+
+/* Next whitespace separated header token as a number, skipping '#' comments */
+static bool pnm_number(const img_file *file, size_t *pos, uint32_t *value) {
+  size_t p = *pos;
+  uint64_t v = 0;
+
+  while (p < file->size) {
+    if (file->bytes[p] == '#') {
+      while (p < file->size && file->bytes[p] != '\n') p++;
+    } else if (isspace(file->bytes[p])) {
+      p++;
+    } else {
+      break;
+    }
+  }
+
+  if (p >= file->size || !isdigit(file->bytes[p])) return false;
+  while (p < file->size && isdigit(file->bytes[p]) && v <= UINT32_MAX)
+    v = v * 10 + (file->bytes[p++] - '0');
+
+  if (v > UINT32_MAX) return false;
+
+  *value = (uint32_t) v;
+  *pos = p;
+  return true;
+}
+
+static bool pam_header(const img_file *file, pnm_info *info) {
+  size_t p = 3;
+  uint32_t maxval = 0;
+
+  while (p < file->size) {
+    const char *line = (const char *) file->bytes + p;
+    const uint8_t *eol = memchr(line, '\n', file->size - p);
+    if (!eol) return false;
+    size_t next = (eol - file->bytes) + 1;
+
+    if (!strncmp(line, "ENDHDR", 6)) {
+      info->offset = next;
+      return maxval == 255 && (info->depth == 3 || info->depth == 4);
+    }
+
+    size_t val = p;
+    while (val < next && !isspace(file->bytes[val])) val++;
+
+    if (!strncmp(line, "WIDTH", 5)) pnm_number(file, &val, &info->width);
+    else if (!strncmp(line, "HEIGHT", 6)) pnm_number(file, &val, &info->height);
+    else if (!strncmp(line, "DEPTH", 5)) pnm_number(file, &val, &info->depth);
+    else if (!strncmp(line, "MAXVAL", 6)) pnm_number(file, &val, &maxval);
+
+    p = next;
+  }
+
+  return false;
+}
+
+/* Only 8 bit RGB(A) netpbm files qualify, anything else is left to stb_image */
+static bool pnm_header(const img_file *file, pnm_info *info) {
+  size_t p = 2;
+  uint32_t maxval = 0;
+
+  memset(info, 0, sizeof(pnm_info));
+  if (file->size < 3 || file->bytes[0] != 'P') return false;
+
+  if (file->bytes[1] == '7') {
+    if (!pam_header(file, info)) return false;
+  } else if (file->bytes[1] == '6') {
+    if (!pnm_number(file, &p, &info->width) || !pnm_number(file, &p, &info->height) || !pnm_number(file, &p, &maxval))
+      return false;
+    if (maxval != 255 || p >= file->size || !isspace(file->bytes[p])) return false;
+    info->depth = 3;
+    info->offset = p + 1; /* Exactly one whitespace byte separates the header from the pixels */
+  } else {
+    return false;
+  }
+
+  if (!info->width || !info->height) return false;
+  return info->offset + (uint64_t) info->width * info->height * info->depth <= file->size;
+}
+
+bool img_probe(const img_file *file, uint32_t *width, uint32_t *height) {
+  pnm_info pnm;
+  int w = 0, h = 0, channels = 0;
+
+  if (pnm_header(file, &pnm)) {
+    *width = pnm.width;
+    *height = pnm.height;
+    return true;
+  }
+
+  if (file->size > INT_MAX || !stbi_info_from_memory(file->bytes, (int) file->size, &w, &h, &channels)) {
+    dlu_log_me(DLU_DANGER, "[x] %s", (file->size > INT_MAX) ? "image file too large" : stbi_failure_reason());
+    return false;
+  }
+
+  *width = w;
+  *height = h;
+  return true;
+}
+
+static bool decode_pnm(const img_file *file, const pnm_info *pnm, img_row_fn row_fn, void *data) {
+  size_t src_pitch = (size_t) pnm->width * pnm->depth;
+  bool ret = true;
+
+  uint32_t *row = malloc(sizeof(uint32_t) * pnm->width);
+  if (!row) { dlu_log_me(DLU_DANGER, "[x] malloc: %s", strerror(errno)); return false; }
+
+  for (uint32_t y = 0; y < pnm->height && ret; y++) {
+    const uint8_t *src = file->bytes + pnm->offset + src_pitch * y;
+
+    if (pnm->depth == 4) convert_rgba_to_argb8888_premul(row, src, pnm->width);
+    else convert_rgb_to_xrgb8888(row, src, pnm->width);
+
+    ret = row_fn(data, y, row);
+  }
+
+  free(row);
+  return ret;
+}
+
+/* libpng pulls its input through a callback, this one walks the mapping */
+struct _png_src {
+  const img_file *file;
+  size_t pos;
+};
+
+static void png_read_mapped(png_structp png, png_bytep out, png_size_t len) {
+  struct _png_src *src = (struct _png_src *) png_get_io_ptr(png);
+
+  if (len > src->file->size - src->pos) png_error(png, "unexpected end of file");
+  memcpy(out, src->file->bytes + src->pos, len);
+  src->pos += len;
+}
+
+static void png_fail(png_structp png, png_const_charp msg) {
+  dlu_log_me(DLU_DANGER, "[x] libpng: %s", msg);
+  png_longjmp(png, 1);
+}
+
+static void png_warn(png_structp png, png_const_charp msg) {
+  (void) png; (void) msg; /* Ancillary chunk noise, not worth a log line per slide */
+}
+
+/**
+* Decodes a non-interlaced PNG one row at a time with png_read_row(), so only a
+* single row exists decoded. Every bit depth and color type is expanded to 8 bit
+* RGBA first. Interlaced files need every pass before a row is final, returns
+* false with *streamed unset and leaves those to stb_image.
+*/
+static bool decode_png(const img_file *file, img_row_fn row_fn, void *data, bool *streamed) {
+  struct _png_src src = { file, 0 };
+  png_structp png = NULL;
+  png_infop info = NULL;
+  uint8_t *volatile src_row = NULL;
+  uint32_t *volatile row = NULL;
+  volatile bool ret = false;
+
+  *streamed = false;
+
+  png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, png_fail, png_warn);
+  if (!png) return false;
+  info = png_create_info_struct(png);
+  if (!info) goto exit_png;
+
+  if (setjmp(png_jmpbuf(png))) { ret = false; goto exit_png; }
+
+  png_set_read_fn(png, &src, png_read_mapped);
+  png_read_info(png, info);
+
+  if (png_get_interlace_type(png, info) != PNG_INTERLACE_NONE) goto exit_png;
+  *streamed = true;
+
+  uint32_t width = png_get_image_width(png, info), height = png_get_image_height(png, info);
+  int color = png_get_color_type(png, info);
+  bool alpha = (color & PNG_COLOR_MASK_ALPHA) || png_get_valid(png, info, PNG_INFO_tRNS);
+
+  /* Whatever the file holds, rows come out as 8 bit RGBA */
+  png_set_expand(png);
+  png_set_strip_16(png);
+  png_set_gray_to_rgb(png);
+  png_set_add_alpha(png, 0xff, PNG_FILLER_AFTER);
+  png_read_update_info(png, info);
+
+  src_row = malloc((size_t) width * 4);
+  row = malloc(sizeof(uint32_t) * width);
+  if (!src_row || !row) { dlu_log_me(DLU_DANGER, "[x] malloc: %s", strerror(errno)); goto exit_png; }
+
+  ret = true;
+  for (uint32_t y = 0; y < height && ret; y++) {
+    png_read_row(png, src_row, NULL);
+
+    if (alpha) convert_rgba_to_argb8888_premul(row, src_row, width);
+    else convert_rgba_to_xrgb8888(row, src_row, width);
+
+    ret = row_fn(data, y, row);
+  }
+
+exit_png:
+  png_destroy_read_struct(&png, (info) ? &info : NULL, NULL);
+  free(src_row);
+  free(row);
+  return ret;
+}
+
+/* libjpeg calls error_exit and expects it not to return */
+struct _jpeg_err {
+  struct jpeg_error_mgr mgr;
+  jmp_buf jmp;
+};
+
+static void jpeg_fail(j_common_ptr cinfo) {
+  char msg[JMSG_LENGTH_MAX];
+
+  cinfo->err->format_message(cinfo, msg);
+  dlu_log_me(DLU_DANGER, "[x] libjpeg: %s", msg);
+  longjmp(((struct _jpeg_err *) cinfo->err)->jmp, 1);
+}
+
+static void jpeg_quiet(j_common_ptr cinfo, int level) {
+  (void) cinfo; (void) level; /* Corrupt data warnings, the image still decodes */
+}
+
+/**
+* Decodes a JPEG a few scanlines at a time with jpeg_read_scanlines(). YCbCr and
+* grayscale come out as RGB. CMYK and YCCK can't be converted by libjpeg, so
+* this returns false with *streamed unset and leaves them to stb_image.
+*/
+static bool decode_jpeg(const img_file *file, img_row_fn row_fn, void *data, bool *streamed) {
+  struct jpeg_decompress_struct cinfo;
+  struct _jpeg_err err;
+  JSAMPROW lines[4];
+  uint8_t *volatile src_rows = NULL;
+  uint32_t *volatile row = NULL;
+  volatile bool ret = false;
+
+  *streamed = false;
+
+  cinfo.err = jpeg_std_error(&err.mgr);
+  err.mgr.error_exit = jpeg_fail;
+  err.mgr.emit_message = jpeg_quiet;
+  jpeg_create_decompress(&cinfo);
+
+  if (setjmp(err.jmp)) { ret = false; goto exit_jpeg; }
+
+  jpeg_mem_src(&cinfo, file->bytes, file->size);
+  jpeg_read_header(&cinfo, TRUE);
+
+  if (cinfo.jpeg_color_space == JCS_CMYK || cinfo.jpeg_color_space == JCS_YCCK) goto exit_jpeg;
+  *streamed = true;
+
+  cinfo.out_color_space = JCS_RGB;
+  jpeg_start_decompress(&cinfo);
+
+  /* rec_outbuf_height is how many scanlines the decoder is happiest handing out at once, 4 at most */
+  uint32_t width = cinfo.output_width, batch = (cinfo.rec_outbuf_height < 4) ? cinfo.rec_outbuf_height : 4;
+
+  src_rows = malloc((size_t) width * 3 * batch);
+  row = malloc(sizeof(uint32_t) * width);
+  if (!src_rows || !row) { dlu_log_me(DLU_DANGER, "[x] malloc: %s", strerror(errno)); goto exit_jpeg; }
+
+  for (uint32_t i = 0; i < batch; i++) lines[i] = src_rows + (size_t) width * 3 * i;
+
+  ret = true;
+  while (cinfo.output_scanline < cinfo.output_height && ret) {
+    uint32_t y = cinfo.output_scanline;
+    uint32_t got = jpeg_read_scanlines(&cinfo, lines, batch);
+
+    for (uint32_t i = 0; i < got && ret; i++) {
+      convert_rgb_to_xrgb8888(row, lines[i], width);
+      ret = row_fn(data, y + i, row);
+    }
+  }
+
+  if (ret) jpeg_finish_decompress(&cinfo);
+
+exit_jpeg:
+  jpeg_destroy_decompress(&cinfo);
+  free(src_rows);
+  free(row);
+  return ret;
+}
+
+static bool decode_stbi(const img_file *file, img_row_fn row_fn, void *data) {
+  int w = 0, h = 0, channels = 0;
+  bool ret = true;
+
+  uint8_t *pixels = stbi_load_from_memory(file->bytes, (int) file->size, &w, &h, &channels, STBI_rgb_alpha);
+  if (!pixels) { dlu_log_me(DLU_DANGER, "[x] %s", stbi_failure_reason()); return false; }
+
+  /* Swizzle in place. Real alpha gets premultiplied so it blends against the black background */
+  if (channels == 4) convert_rgba_to_argb8888_premul((uint32_t *) pixels, pixels, (uint32_t) w * h);
+  else convert_rgba_to_xrgb8888((uint32_t *) pixels, pixels, (uint32_t) w * h);
+
+  for (int y = 0; y < h && ret; y++)
+    ret = row_fn(data, y, (const uint32_t *) pixels + (size_t) w * y);
+
+  stbi_image_free(pixels);
+  return ret;
+}
+
+bool img_decode_rows(const img_file *file, img_row_fn row_fn, void *data) {
+  bool ret = false, streamed = false;
+  pnm_info pnm;
+
+  if (pnm_header(file, &pnm)) return decode_pnm(file, &pnm, row_fn, data);
+
+  if (file->size >= 8 && !png_sig_cmp(file->bytes, 0, 8)) ret = decode_png(file, row_fn, data, &streamed);
+  else if (file->size >= 3 && !memcmp(file->bytes, "\xff\xd8\xff", 3)) ret = decode_jpeg(file, row_fn, data, &streamed);
+  if (streamed) return ret;
+
+  if (file->size > INT_MAX) return false;
+
+  return decode_stbi(file, row_fn, data);
+}
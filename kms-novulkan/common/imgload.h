@@ -0,0 +1,57 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#ifndef IMGLOAD_H
+#define IMGLOAD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+* Images are decoded straight out of a read-only mapping of the file, so the
+* encoded bytes never get copied into the heap. Decoded pixels are handed out
+* one row at a time in XRGB8888 (alpha premultiplied). Binary PPM (P6) and
+* PAM (P7) are streamed directly from the mapping, PNG through libpng's
+* png_read_row() and JPEG through libjpeg's jpeg_read_scanlines(), so none of
+* them ever exist as a whole decoded image. Interlaced PNG, CMYK JPEG and every
+* other format are decoded whole by stb_image first.
+*/
+typedef struct _img_file {
+  uint8_t *bytes;
+  size_t size;
+} img_file;
+
+/* Return false to stop decoding */
+typedef bool (*img_row_fn)(void *data, uint32_t y, const uint32_t *row);
+
+bool img_file_map(img_file *file, const char *path);
+void img_file_unmap(img_file *file);
+
+bool img_probe(const img_file *file, uint32_t *width, uint32_t *height);
+
+/* Calls row_fn for every row, top to bottom */
+bool img_decode_rows(const img_file *file, img_row_fn row_fn, void *data);
+
+#endif
@@ -0,0 +1,140 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
+
+#include <drm_fourcc.h>
+
+#include "rawcache.h"
+#include "imgupload.h"
+
+/* Every BO (or the one staging frame) being written while the image decodes */
+struct _upload {
+  blit_stream **streams;
+  uint32_t count;
+};
+
+/* Fans each decoded row out to every destination, so the image never has to exist in full */
+static bool upload_row(void *data, uint32_t y, const uint32_t *row) {
+  struct _upload *up = (struct _upload *) data;
+
+  for (uint32_t i = 0; i < up->count; i++)
+    if (!blit_stream_row(up->streams[i], y, row)) return false;
+
+  return true;
+}
+
+bool img_upload_run(const img_upload *img_up, const blit_surface *target) {
+  blit_surface dst = *target;
+  struct _upload up = { NULL, 0 };
+  raw_frame cached;
+  uint32_t mapped = 0;
+  uint8_t *frame = NULL, *staging = NULL;
+  size_t frame_bytes = 0;
+  bool ret = false, hit = false;
+
+  memset(&cached, 0, sizeof(raw_frame));
+
+  if (img_up->use_cache) {
+    /* Same file shown on the same mode the same way gives the same frame */
+    uint32_t params[] = { dst.width, dst.height, dst.pitch, DRM_FORMAT_XRGB8888, img_up->fit, img_up->filter };
+    uint64_t key = rawcache_key(img_up->img->bytes, img_up->img->size, params, sizeof(params) / sizeof(params[0]));
+
+    hit = rawcache_open(&cached, key, dst.width, dst.height, dst.pitch, DRM_FORMAT_XRGB8888);
+    if (!hit) rawcache_create(&cached, key, dst.width, dst.height, dst.pitch, DRM_FORMAT_XRGB8888);
+
+    /* NULL if the cache can't be written, which only costs the next run a decode */
+    frame = cached.pixels;
+    frame_bytes = cached.bytes;
+  }
+
+  up.streams = calloc(img_up->count + 1, sizeof(blit_stream *));
+  if (!up.streams) { dlu_log_me(DLU_DANGER, "[x] calloc: %s", strerror(errno)); goto exit_upload; }
+
+  if (!frame && !img_up->maps) {
+    /* dlu_fb_gbm_bo_write() wants the frame laid out exactly as it will land in the BO */
+    frame_bytes = (size_t) dst.pitch * dst.height;
+    staging = mmap(NULL, frame_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+    if (staging == MAP_FAILED) { dlu_log_me(DLU_DANGER, "[x] mmap: %s", strerror(errno)); staging = NULL; goto exit_upload; }
+    frame = staging;
+  }
+
+  if (frame && !hit) {
+    dst.pixels = frame;
+    up.streams[0] = blit_stream_create(&dst, img_up->img_width, img_up->img_height, img_up->fit, img_up->filter, 0);
+    if (!up.streams[up.count++]) goto exit_upload;
+  }
+
+  if (img_up->maps) {
+    for (; mapped < img_up->count; mapped++) {
+      bo_map *map = &img_up->maps[mapped];
+      if (!bo_map_begin(map)) goto exit_upload;
+
+      /* A single memcpy when the entry was written with this BO's stride */
+      if (hit) {
+        bo_map_copy(map, frame, dst.pitch, dst.pitch, dst.height);
+        continue;
+      }
+
+      blit_surface bo_dst = { map->pixels, dst.width, dst.height, map->stride };
+      up.streams[up.count] = blit_stream_create(&bo_dst, img_up->img_width, img_up->img_height, img_up->fit, img_up->filter, 0);
+      if (!up.streams[up.count++]) { mapped++; goto exit_upload; }
+    }
+  }
+
+  if (hit) dlu_log_me(DLU_INFO, "Using cached frame %s for %s", cached.path, (img_up->name) ? img_up->name : "the output");
+  else if (!img_decode_rows(img_up->img, upload_row, &up)) goto exit_upload;
+
+  /* A decoder that gave up early would leave a partly blank frame, in the BOs and the cache */
+  for (uint32_t i = 0; i < up.count; i++) {
+    if (blit_stream_done(up.streams[i])) continue;
+    dlu_log_me(DLU_DANGER, "[x] image ended before every row was decoded");
+    goto exit_upload;
+  }
+
+  /* Failing to commit leaves the old entry (if any) alone and the temp file is removed on close */
+  if (!hit && cached.pixels) rawcache_commit(&cached);
+
+  if (!img_up->maps)
+    for (uint32_t i = 0; i < img_up->count; i++)
+      dlu_fb_gbm_bo_write(img_up->buffs[i].bo, frame, frame_bytes);
+
+  ret = true;
+
+exit_upload:
+  for (uint32_t i = 0; i < up.count; i++)
+    blit_stream_destroy(up.streams[i]);
+  free(up.streams);
+
+  for (uint32_t i = 0; i < mapped; i++)
+    bo_map_end(&img_up->maps[i]);
+
+  if (staging) munmap(staging, frame_bytes);
+  rawcache_close(&cached);
+  return ret;
+}
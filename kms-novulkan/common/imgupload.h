@@ -0,0 +1,64 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#ifndef IMGUPLOAD_H
+#define IMGUPLOAD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define LUCUR_DISPLAY_API
+#include <dluc/lucurious.h>
+
+#include "bomap.h"
+#include "blit.h"
+#include "imgload.h"
+
+/**
+* A static image never changes, so it is decoded and scaled into every scanout BO
+* once up front. Rows go from the file mapping to the BOs (or one staging frame
+* without zero-copy) as they are decoded. After that flips cost no CPU bandwidth.
+*
+* With use_cache the composed frame is also written to the raw frame cache. Later
+* runs with the same file and mode skip the decoder entirely and copy the mapped
+* entry into each BO in one go.
+*/
+typedef struct _img_upload {
+  const img_file *img;
+  uint32_t img_width;
+  uint32_t img_height;
+  blit_fit fit;
+  blit_filter filter;
+  bool use_cache;
+  const char *name; /* Output the frame is for, only logged. May be NULL */
+
+  uint32_t count; /* BOs to fill */
+  bo_map *maps; /* Written in place when set (zero-copy), else... */
+  dlu_disp_buff_data *buffs; /* ...a staged frame goes out through dlu_fb_gbm_bo_write() */
+} img_upload;
+
+/* dst describes the frame, pixels unset. Leaves the BO mappings alone */
+bool img_upload_run(const img_upload *up, const blit_surface *dst);
+
+#endif
@@ -0,0 +1,77 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+
+#define LUCUR_DISPLAY_API
+#include <dluc/lucurious.h>
+
+#include "kmsfence.h"
+#include "kmsprops.h"
+
+bool kms_fence_init(kms_fence *fence, int kmsfd, uint32_t crtc_id, uint32_t plane_id) {
+  memset(fence, 0, sizeof(kms_fence));
+  fence->crtc_id = crtc_id;
+  fence->plane_id = plane_id;
+  fence->out_fence = -1;
+
+  fence->out_fence_ptr = kms_prop_id(kmsfd, crtc_id, DRM_MODE_OBJECT_CRTC, "OUT_FENCE_PTR");
+  fence->in_fence_fd = kms_prop_id(kmsfd, plane_id, DRM_MODE_OBJECT_PLANE, "IN_FENCE_FD");
+
+  if (!fence->out_fence_ptr || !fence->in_fence_fd) {
+    dlu_log_me(DLU_DANGER, "[x] Driver has no OUT_FENCE_PTR/IN_FENCE_FD properties");
+    return false;
+  }
+
+  return true;
+}
+
+bool kms_fence_add(kms_fence *fence, drmModeAtomicReq *req, int in_fence) {
+  fence->out_fence = -1;
+
+  if (drmModeAtomicAddProperty(req, fence->crtc_id, fence->out_fence_ptr, (uint64_t) (uintptr_t) &fence->out_fence) < 0) {
+    dlu_log_me(DLU_DANGER, "[x] drmModeAtomicAddProperty: OUT_FENCE_PTR: %s", strerror(errno));
+    return false;
+  }
+
+  if (in_fence != -1 && drmModeAtomicAddProperty(req, fence->plane_id, fence->in_fence_fd, in_fence) < 0) {
+    dlu_log_me(DLU_DANGER, "[x] drmModeAtomicAddProperty: IN_FENCE_FD: %s", strerror(errno));
+    return false;
+  }
+
+  return true;
+}
+
+int kms_fence_take(kms_fence *fence) {
+  int fd = fence->out_fence;
+  fence->out_fence = -1;
+  return fd;
+}
@@ -0,0 +1,56 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#ifndef KMSFENCE_H
+#define KMSFENCE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <xf86drmMode.h>
+
+/**
+* Explicit fencing for atomic commits. Every commit asks for an out-fence
+* (OUT_FENCE_PTR on the CRTC), a sync_file that signals once the new frame is
+* on screen and the previous buffer is released. A buffer whose producer is
+* still writing it can be committed right away with its fence as IN_FENCE_FD
+* on the plane, the kernel waits on it instead of the event thread.
+*/
+typedef struct _kms_fence {
+  uint32_t crtc_id;
+  uint32_t plane_id;
+  uint32_t out_fence_ptr; /* Property ids, 0 if the driver doesn't have them */
+  uint32_t in_fence_fd;
+  int32_t out_fence; /* The kernel writes the fd here during the commit, must be an s32 */
+} kms_fence;
+
+bool kms_fence_init(kms_fence *fence, int kmsfd, uint32_t crtc_id, uint32_t plane_id);
+
+/* Adds OUT_FENCE_PTR, and IN_FENCE_FD when in_fence isn't -1, to a request that's about to be committed */
+bool kms_fence_add(kms_fence *fence, drmModeAtomicReq *req, int in_fence);
+
+/* Once the commit went through: the out-fence fd (the caller owns it), -1 if there's none */
+int kms_fence_take(kms_fence *fence);
+
+#endif
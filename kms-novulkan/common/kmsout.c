@@ -0,0 +1,142 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+
+#include "kmsout.h"
+#include "kmsprops.h"
+
+static bool plane_is_primary(int fd, uint32_t plane_id) {
+  uint64_t type = DRM_PLANE_TYPE_OVERLAY;
+  return kms_prop_value(fd, plane_id, DRM_MODE_OBJECT_PLANE, "type", &type) && type == DRM_PLANE_TYPE_PRIMARY;
+}
+
+static bool chain_uses(const dlu_disp_device_info *dinfo, uint32_t count, uint32_t crtc_idx, uint32_t plane_idx) {
+  for (uint32_t i = 0; i < count; i++)
+    if (dinfo[i].crtc_idx == crtc_idx || dinfo[i].plane_idx == plane_idx) return true;
+  return false;
+}
+
+/* First primary plane that can sit on crtc_idx and isn't taken, -1 if there's none */
+static int32_t free_plane(int fd, drmModePlaneRes *planes, const dlu_disp_device_info *dinfo, uint32_t count, uint32_t crtc_idx) {
+  for (uint32_t p = 0; p < planes->count_planes; p++) {
+    if (chain_uses(dinfo, count, UINT32_MAX, p)) continue;
+
+    drmModePlane *plane = drmModeGetPlane(fd, planes->planes[p]);
+    if (!plane) continue;
+    bool fits = plane->possible_crtcs & (1u << crtc_idx);
+    drmModeFreePlane(plane);
+
+    if (fits && plane_is_primary(fd, planes->planes[p])) return p;
+  }
+
+  return -1;
+}
+
+/* Walks the connector's encoders for a free CRTC with a free primary plane */
+static bool claim_chain(int fd, drmModeRes *res, drmModePlaneRes *planes, drmModeConnector *conn,
+                        dlu_disp_device_info *dinfo, uint32_t count) {
+  for (int e = 0; e < conn->count_encoders; e++) {
+    int enc_idx = -1;
+    for (int i = 0; i < res->count_encoders && enc_idx == -1; i++)
+      if (res->encoders[i] == conn->encoders[e]) enc_idx = i;
+    if (enc_idx == -1) continue;
+
+    drmModeEncoder *enc = drmModeGetEncoder(fd, conn->encoders[e]);
+    if (!enc) continue;
+    uint32_t possible = enc->possible_crtcs;
+    drmModeFreeEncoder(enc);
+
+    for (int c = 0; c < res->count_crtcs && c < 32; c++) {
+      if (!(possible & (1u << c)) || chain_uses(dinfo, count, c, UINT32_MAX)) continue;
+
+      int32_t plane_idx = free_plane(fd, planes, dinfo, count, c);
+      if (plane_idx == -1) continue;
+
+      dinfo[count].enc_idx = enc_idx;
+      dinfo[count].crtc_idx = c;
+      dinfo[count].plane_idx = plane_idx;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+uint32_t kms_output_chains(int fd, dlu_disp_device_info *dinfo, uint32_t max) {
+  uint32_t count = 1;
+
+  /* Primary planes are only listed with universal planes on */
+  drmSetClientCap(fd, DRM_CLIENT_CAP_UNIVERSAL_PLANES, 1);
+
+  drmModeRes *res = drmModeGetResources(fd);
+  drmModePlaneRes *planes = drmModeGetPlaneResources(fd);
+  if (!res || !planes) {
+    dlu_log_me(DLU_DANGER, "[x] drmModeGetResources: %s", strerror(errno));
+    goto exit_chains;
+  }
+
+  for (int i = 0; i < res->count_connectors && count < max; i++) {
+    if ((uint32_t) i == dinfo[0].conn_idx) continue;
+
+    drmModeConnector *conn = drmModeGetConnector(fd, res->connectors[i]);
+    if (!conn) continue;
+
+    if (conn->connection != DRM_MODE_CONNECTED || !conn->count_modes) {
+      drmModeFreeConnector(conn);
+      continue;
+    }
+
+    if (!claim_chain(fd, res, planes, conn, dinfo, count)) {
+      dlu_log_me(DLU_WARNING, "No free CRTC and primary plane left for connector %u, skipping it", conn->connector_id);
+      drmModeFreeConnector(conn);
+      continue;
+    }
+
+    /* Preferred mode, same as the first chain gets */
+    drmModeModeInfo *mode = &conn->modes[0];
+    for (int m = 0; m < conn->count_modes; m++)
+      if (conn->modes[m].type & DRM_MODE_TYPE_PREFERRED) { mode = &conn->modes[m]; break; }
+
+    const char *type = drmModeGetConnectorTypeName(conn->connector_type);
+    snprintf(dinfo[count].conn_name, sizeof(dinfo[count].conn_name), "%s-%u", type ? type : "Unknown", conn->connector_type_id);
+    dinfo[count].conn_idx = i;
+    dinfo[count].refresh = mode->vrefresh;
+    count++;
+
+    drmModeFreeConnector(conn);
+  }
+
+exit_chains:
+  if (planes) drmModeFreePlaneResources(planes);
+  if (res) drmModeFreeResources(res);
+  return count;
+}
@@ -0,0 +1,45 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#ifndef KMSOUT_H
+#define KMSOUT_H
+
+#include <stdint.h>
+
+#define LUCUR_DISPLAY_API
+#include <dluc/lucurious.h>
+
+/* Outputs driven at once, also what the lucurious memory block is sized for */
+#define KMS_OUTPUT_MAX 8
+
+/**
+* dlu_kms_q_output_chain() settles on a single Connector -> Encoder -> CRTC -> Plane
+* chain. Given that one in dinfo[0], this appends a chain for every other connected
+* connector, each with a CRTC and primary plane nobody else in dinfo uses, in the
+* same form so they can go to dlu_kms_enum_device(). Returns how many dinfo now
+* holds, at most max and never less than 1.
+*/
+uint32_t kms_output_chains(int fd, dlu_disp_device_info *dinfo, uint32_t max);
+
+#endif
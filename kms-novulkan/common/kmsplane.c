@@ -0,0 +1,159 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+#include <drm_fourcc.h>
+
+#define LUCUR_DISPLAY_API
+#include <dluc/lucurious.h>
+
+#include "kmsplane.h"
+#include "kmsprops.h"
+
+static const char *plane_prop_names[KMS_PLANE_PROP_MAX] = {
+  "FB_ID", "CRTC_ID", "SRC_X", "SRC_Y", "SRC_W", "SRC_H", "CRTC_X", "CRTC_Y", "CRTC_W", "CRTC_H"
+};
+
+static bool plane_takes_xrgb(const drmModePlane *plane) {
+  for (uint32_t i = 0; i < plane->count_formats; i++)
+    if (plane->formats[i] == DRM_FORMAT_XRGB8888) return true;
+  return false;
+}
+
+uint32_t kms_overlay_planes(int fd, uint32_t crtc_idx, uint32_t *plane_ids, uint32_t max) {
+  uint32_t count = 0;
+
+  /* Overlays are listed either way, but the type property is only there with universal planes */
+  drmSetClientCap(fd, DRM_CLIENT_CAP_UNIVERSAL_PLANES, 1);
+
+  drmModePlaneRes *planes = drmModeGetPlaneResources(fd);
+  if (!planes) {
+    dlu_log_me(DLU_DANGER, "[x] drmModeGetPlaneResources: %s", strerror(errno));
+    return 0;
+  }
+
+  for (uint32_t p = 0; p < planes->count_planes && count < max; p++) {
+    uint64_t type = DRM_PLANE_TYPE_PRIMARY;
+    if (!kms_prop_value(fd, planes->planes[p], DRM_MODE_OBJECT_PLANE, "type", &type) || type != DRM_PLANE_TYPE_OVERLAY)
+      continue;
+
+    drmModePlane *plane = drmModeGetPlane(fd, planes->planes[p]);
+    if (!plane) continue;
+    if ((plane->possible_crtcs & (1u << crtc_idx)) && plane_takes_xrgb(plane))
+      plane_ids[count++] = plane->plane_id;
+    drmModeFreePlane(plane);
+  }
+
+  drmModeFreePlaneResources(planes);
+  return count;
+}
+
+bool kms_plane_init(kms_plane *plane, int fd, uint32_t plane_id, uint32_t crtc_id) {
+  memset(plane, 0, sizeof(kms_plane));
+  plane->plane_id = plane_id;
+  plane->crtc_id = crtc_id;
+
+  for (uint32_t i = 0; i < KMS_PLANE_PROP_MAX; i++) {
+    plane->props[i] = kms_prop_id(fd, plane_id, DRM_MODE_OBJECT_PLANE, plane_prop_names[i]);
+    if (!plane->props[i]) {
+      dlu_log_me(DLU_WARNING, "Plane %u has no %s property", plane_id, plane_prop_names[i]);
+      return false;
+    }
+  }
+
+  /* Optional, only lets the driver skip uploading what didn't change */
+  plane->damage_clips = kms_prop_id(fd, plane_id, DRM_MODE_OBJECT_PLANE, "FB_DAMAGE_CLIPS");
+
+  return true;
+}
+
+bool kms_plane_add(const kms_plane *plane, drmModeAtomicReq *req, uint32_t fb_id, uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+  /* Source coordinates are 16.16 fixed point, the CRTC ones whole pixels */
+  uint64_t values[KMS_PLANE_PROP_MAX] = {
+    fb_id, plane->crtc_id, 0, 0, (uint64_t) width << 16, (uint64_t) height << 16, x, y, width, height
+  };
+
+  for (uint32_t i = 0; i < KMS_PLANE_PROP_MAX; i++) {
+    if (drmModeAtomicAddProperty(req, plane->plane_id, plane->props[i], values[i]) < 0) {
+      dlu_log_me(DLU_DANGER, "[x] drmModeAtomicAddProperty: %s: %s", plane_prop_names[i], strerror(errno));
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool kms_plane_add_fb(const kms_plane *plane, drmModeAtomicReq *req, uint32_t fb_id) {
+  if (drmModeAtomicAddProperty(req, plane->plane_id, plane->props[KMS_PLANE_FB_ID], fb_id) < 0) {
+    dlu_log_me(DLU_DANGER, "[x] drmModeAtomicAddProperty: FB_ID: %s", strerror(errno));
+    return false;
+  }
+
+  return true;
+}
+
+bool kms_plane_add_damage(const kms_plane *plane, drmModeAtomicReq *req, uint32_t blob_id) {
+  if (!plane->damage_clips || !blob_id) return true;
+
+  if (drmModeAtomicAddProperty(req, plane->plane_id, plane->damage_clips, blob_id) < 0) {
+    dlu_log_me(DLU_DANGER, "[x] drmModeAtomicAddProperty: FB_DAMAGE_CLIPS: %s", strerror(errno));
+    return false;
+  }
+
+  return true;
+}
+
+bool kms_plane_disable(const kms_plane *plane, drmModeAtomicReq *req) {
+  if (drmModeAtomicAddProperty(req, plane->plane_id, plane->props[KMS_PLANE_FB_ID], 0) < 0 ||
+      drmModeAtomicAddProperty(req, plane->plane_id, plane->props[KMS_PLANE_CRTC_ID], 0) < 0) {
+    dlu_log_me(DLU_DANGER, "[x] drmModeAtomicAddProperty: %s", strerror(errno));
+    return false;
+  }
+
+  return true;
+}
+
+uint32_t kms_damage_blob(int fd, uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+  struct drm_mode_rect rect = { x, y, x + width, y + height };
+  uint32_t blob_id = 0;
+
+  if (drmModeCreatePropertyBlob(fd, &rect, sizeof(rect), &blob_id) < 0) {
+    dlu_log_me(DLU_WARNING, "[x] drmModeCreatePropertyBlob: %s", strerror(errno));
+    return 0;
+  }
+
+  return blob_id;
+}
+
+bool kms_atomic_test(int fd, drmModeAtomicReq *req, bool modeset) {
+  uint32_t flags = DRM_MODE_ATOMIC_TEST_ONLY | ((modeset) ? DRM_MODE_ATOMIC_ALLOW_MODESET : 0);
+  return drmModeAtomicCommit(fd, req, flags, NULL) == 0;
+}
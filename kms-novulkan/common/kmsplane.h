@@ -0,0 +1,92 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#ifndef KMSPLANE_H
+#define KMSPLANE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <xf86drmMode.h>
+
+/**
+* A layer scanned out from a plane of its own, so the display hardware
+* composes it over the primary plane and the CPU never has to. Whether a
+* given plane can take a given layer (format, size, position, scaling,
+* bandwidth) is only known by asking the driver, so every configuration
+* goes through a TEST_ONLY commit before the first real one.
+*
+* Property ids are looked up once in kms_plane_init(). After the first commit
+* only what changed needs adding, usually FB_ID and maybe the damage.
+*/
+typedef enum _kms_plane_prop {
+  KMS_PLANE_FB_ID = 0,
+  KMS_PLANE_CRTC_ID,
+  KMS_PLANE_SRC_X,
+  KMS_PLANE_SRC_Y,
+  KMS_PLANE_SRC_W,
+  KMS_PLANE_SRC_H,
+  KMS_PLANE_CRTC_X,
+  KMS_PLANE_CRTC_Y,
+  KMS_PLANE_CRTC_W,
+  KMS_PLANE_CRTC_H,
+  KMS_PLANE_PROP_MAX
+} kms_plane_prop;
+
+typedef struct _kms_plane {
+  uint32_t plane_id;
+  uint32_t crtc_id;
+  uint32_t props[KMS_PLANE_PROP_MAX];
+  uint32_t damage_clips; /* FB_DAMAGE_CLIPS, 0 when the driver doesn't take damage hints */
+} kms_plane;
+
+/* Overlay planes that can be put on crtc_idx and scan out XRGB8888, returns how many went into plane_ids */
+uint32_t kms_overlay_planes(int fd, uint32_t crtc_idx, uint32_t *plane_ids, uint32_t max);
+
+bool kms_plane_init(kms_plane *plane, int fd, uint32_t plane_id, uint32_t crtc_id);
+
+/* Shows all of fb_id at x, y on the CRTC, unscaled */
+bool kms_plane_add(const kms_plane *plane, drmModeAtomicReq *req, uint32_t fb_id, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+
+/* Just a new buffer for a plane that's already placed */
+bool kms_plane_add_fb(const kms_plane *plane, drmModeAtomicReq *req, uint32_t fb_id);
+
+/* Only the area in blob_id (see kms_damage_blob()) changed since the last buffer, a no-op without FB_DAMAGE_CLIPS */
+bool kms_plane_add_damage(const kms_plane *plane, drmModeAtomicReq *req, uint32_t blob_id);
+
+/* Takes the plane off its CRTC */
+bool kms_plane_disable(const kms_plane *plane, drmModeAtomicReq *req);
+
+/* Property blob holding a single damage rectangle, 0 on failure. Free with drmModeDestroyPropertyBlob() */
+uint32_t kms_damage_blob(int fd, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+
+/**
+* Asks the driver whether req would commit, without touching the hardware. modeset has
+* to be set when req carries the mode and CRTC activation of a first commit: unless the
+* CRTC already runs that mode (it won't headless, on vkms or after another DRM master)
+* the kernel refuses a modeset that isn't allowed, whatever the planes look like.
+*/
+bool kms_atomic_test(int fd, drmModeAtomicReq *req, bool modeset);
+
+#endif
@@ -0,0 +1,102 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+
+#define LUCUR_DISPLAY_API
+#include <dluc/lucurious.h>
+
+#include "kmsprops.h"
+
+uint32_t kms_prop_id(int fd, uint32_t obj_id, uint32_t obj_type, const char *name) {
+  uint32_t id = 0;
+
+  drmModeObjectProperties *props = drmModeObjectGetProperties(fd, obj_id, obj_type);
+  if (!props) {
+    dlu_log_me(DLU_DANGER, "[x] drmModeObjectGetProperties: %s", strerror(errno));
+    return 0;
+  }
+
+  for (uint32_t i = 0; i < props->count_props && !id; i++) {
+    drmModePropertyRes *prop = drmModeGetProperty(fd, props->props[i]);
+    if (!prop) continue;
+    if (!strcmp(prop->name, name)) id = prop->prop_id;
+    drmModeFreeProperty(prop);
+  }
+
+  drmModeFreeObjectProperties(props);
+  return id;
+}
+
+bool kms_prop_value(int fd, uint32_t obj_id, uint32_t obj_type, const char *name, uint64_t *value) {
+  bool found = false;
+
+  drmModeObjectProperties *props = drmModeObjectGetProperties(fd, obj_id, obj_type);
+  if (!props) {
+    dlu_log_me(DLU_DANGER, "[x] drmModeObjectGetProperties: %s", strerror(errno));
+    return false;
+  }
+
+  for (uint32_t i = 0; i < props->count_props && !found; i++) {
+    drmModePropertyRes *prop = drmModeGetProperty(fd, props->props[i]);
+    if (!prop) continue;
+    if (!strcmp(prop->name, name)) { *value = props->prop_values[i]; found = true; }
+    drmModeFreeProperty(prop);
+  }
+
+  drmModeFreeObjectProperties(props);
+  return found;
+}
+
+bool kms_object_ids(int fd, uint32_t crtc_idx, uint32_t plane_idx, uint32_t *crtc_id, uint32_t *plane_id) {
+  bool ret = false;
+
+  drmModeRes *res = drmModeGetResources(fd);
+  drmModePlaneRes *planes = drmModeGetPlaneResources(fd);
+  if (!res || !planes) {
+    dlu_log_me(DLU_DANGER, "[x] drmModeGetResources: %s", strerror(errno));
+    goto exit_ids;
+  }
+
+  if ((int) crtc_idx >= res->count_crtcs || plane_idx >= planes->count_planes) {
+    dlu_log_me(DLU_DANGER, "[x] CRTC %u or plane %u out of range", crtc_idx, plane_idx);
+    goto exit_ids;
+  }
+
+  *crtc_id = res->crtcs[crtc_idx];
+  *plane_id = planes->planes[plane_idx];
+  ret = true;
+
+exit_ids:
+  if (planes) drmModeFreePlaneResources(planes);
+  if (res) drmModeFreeResources(res);
+  return ret;
+}
@@ -0,0 +1,40 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#ifndef KMSPROPS_H
+#define KMSPROPS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Property id called name on a KMS object, 0 if the object doesn't have it */
+uint32_t kms_prop_id(int fd, uint32_t obj_id, uint32_t obj_type, const char *name);
+
+/* Current value of the property called name on a KMS object, false if the object doesn't have it */
+bool kms_prop_value(int fd, uint32_t obj_id, uint32_t obj_type, const char *name, uint64_t *value);
+
+/* CRTC and plane ids behind the indices dlu_kms_q_output_chain() hands out */
+bool kms_object_ids(int fd, uint32_t crtc_idx, uint32_t plane_idx, uint32_t *crtc_id, uint32_t *plane_id);
+
+#endif
@@ -0,0 +1,80 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/timerfd.h>
+
+#define LUCUR_DISPLAY_API
+#include <dluc/lucurious.h>
+
+#include "kmsretry.h"
+
+bool kms_retry_init(kms_retry *rt) {
+  memset(rt, 0, sizeof(kms_retry));
+
+  rt->timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (rt->timerfd == -1) {
+    dlu_log_me(DLU_DANGER, "[x] timerfd_create: %s", strerror(errno));
+    return false;
+  }
+
+  return true;
+}
+
+void kms_retry_fini(kms_retry *rt) {
+  if (rt->timerfd >= 0) close(rt->timerfd);
+  rt->timerfd = -1;
+
+  if (rt->failed) dlu_log_me(DLU_WARNING, "%" PRIu64 " submissions turned down by the kernel and retried", rt->failed);
+}
+
+void kms_retry_arm(kms_retry *rt) {
+  rt->failed++;
+  if (rt->armed || rt->timerfd < 0) return;
+
+  struct itimerspec its;
+  memset(&its, 0, sizeof(its));
+  its.it_value.tv_nsec = (long) (KMS_RETRY_DELAY * 1e9);
+
+  if (timerfd_settime(rt->timerfd, 0, &its, NULL) == -1) {
+    dlu_log_me(DLU_DANGER, "[x] timerfd_settime: %s", strerror(errno));
+    return;
+  }
+
+  rt->armed = true;
+}
+
+void kms_retry_fired(kms_retry *rt) {
+  uint64_t expirations = 0;
+
+  if (read(rt->timerfd, &expirations, sizeof(expirations)) == -1 && errno != EAGAIN)
+    dlu_log_me(DLU_WARNING, "[x] read: timerfd: %s", strerror(errno));
+
+  rt->armed = false;
+}
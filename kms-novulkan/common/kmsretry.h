@@ -0,0 +1,54 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#ifndef KMSRETRY_H
+#define KMSRETRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+* A flip or commit the kernel turned down (EBUSY, a plane that went away, ...)
+* produces no event, so nothing would ever submit the output's queued frames
+* again. The failed buffer goes back to the front of its queue and this one
+* shot timerfd, sitting in the epoll loop, gets another go at it a little later.
+*/
+#define KMS_RETRY_DELAY 0.004 /* Seconds, a quarter of a 60 Hz frame */
+
+typedef struct _kms_retry {
+  int timerfd;
+  bool armed;
+  uint64_t failed; /* Submissions that were turned down */
+} kms_retry;
+
+bool kms_retry_init(kms_retry *rt);
+void kms_retry_fini(kms_retry *rt);
+
+/* A submission failed, fires once after KMS_RETRY_DELAY. Already armed stays as is */
+void kms_retry_arm(kms_retry *rt);
+
+/* Call when the timer fires, consumes the expiration */
+void kms_retry_fired(kms_retry *rt);
+
+#endif
@@ -0,0 +1,73 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <string.h>
+#include <stdint.h>
+
+/* For Libinput input event codes */
+#include <linux/input-event-codes.h>
+
+#define LUCUR_DISPLAY_API
+#include <dluc/lucurious.h>
+
+#include "quit.h"
+
+volatile sig_atomic_t caught_signal = 0;
+
+static void catch_signal(int sig) {
+  caught_signal = sig;
+}
+
+void catch_signals(void) {
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = catch_signal;
+  sigemptyset(&sa.sa_mask);
+
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+  sigaction(SIGUSR1, &sa, NULL);
+}
+
+/**
+* Pulls until libinput has nothing left. Events that aren't keys (pointer motion,
+* device added) leave key_code alone and are skipped, an ESC queued behind them
+* would otherwise wait for the next edge.
+*/
+bool input_ready(ev_source *src) {
+  dlu_disp_core *core = (dlu_disp_core *) src->data;
+  uint32_t key_code = UINT32_MAX;
+
+  while (1) {
+    key_code = UINT32_MAX;
+    src->syscalls++; /* At least the read of libinput's own epoll fd */
+    if (!dlu_input_retrieve(core, &key_code)) return true;
+
+    switch(key_code) {
+      case KEY_ESC: return false;
+      case KEY_Q: return false;
+      default: break;
+    }
+  }
+}
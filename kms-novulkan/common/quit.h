@@ -0,0 +1,48 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#ifndef QUIT_H
+#define QUIT_H
+
+#include <stdbool.h>
+#include <signal.h>
+
+#include "evloop.h"
+
+/**
+* Ways out of the examples' main loops. SIGUSR1 prints the flip stats so far,
+* SIGINT and SIGTERM quit cleanly so they get printed on the way out. ESC or q
+* on any keyboard quits too.
+*/
+
+/* Last signal caught, the loop clears it once handled */
+extern volatile sig_atomic_t caught_signal;
+
+/* No SA_RESTART, epoll_wait() has to come back with EINTR */
+void catch_signals(void);
+
+/* ev_loop handler for libinput's fd, data is the dlu_disp_core. Returns false on ESC or q */
+bool input_ready(ev_source *src);
+
+#endif
@@ -0,0 +1,332 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define LUCUR_DISPLAY_API
+#include <dluc/lucurious.h>
+
+#include "cachefile.h"
+#include "rawcache.h"
+
+/* XXH64 primes, the hash only has to be fast and well spread, not cryptographic */
+#define PRIME1 0x9E3779B185EBCA87ULL
+#define PRIME2 0xC2B2AE3D27D4EB4FULL
+#define PRIME3 0x165667B19E3779F9ULL
+#define PRIME4 0x85EBCA77C2B2AE63ULL
+#define PRIME5 0x27D4EB2F165667C5ULL
+
+static inline uint64_t rotl64(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+static inline uint64_t read64(const uint8_t *p) { uint64_t v; memcpy(&v, p, 8); return v; }
+static inline uint32_t read32(const uint8_t *p) { uint32_t v; memcpy(&v, p, 4); return v; }
+
+static inline uint64_t round64(uint64_t acc, uint64_t input) {
+  return rotl64(acc + input * PRIME2, 31) * PRIME1;
+}
+
+static inline uint64_t merge64(uint64_t acc, uint64_t val) {
+  return (acc ^ round64(0, val)) * PRIME1 + PRIME4;
+}
+
+static uint64_t xxh64(const uint8_t *p, size_t len, uint64_t seed) {
+  const uint8_t *end = p + len;
+  uint64_t h;
+
+  if (len >= 32) {
+    uint64_t v1 = seed + PRIME1 + PRIME2, v2 = seed + PRIME2, v3 = seed, v4 = seed - PRIME1;
+    const uint8_t *limit = end - 32;
+
+    do {
+      v1 = round64(v1, read64(p)); v2 = round64(v2, read64(p + 8));
+      v3 = round64(v3, read64(p + 16)); v4 = round64(v4, read64(p + 24));
+      p += 32;
+    } while (p <= limit);
+
+    h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+    h = merge64(h, v1); h = merge64(h, v2); h = merge64(h, v3); h = merge64(h, v4);
+  } else {
+    h = seed + PRIME5;
+  }
+
+  h += len;
+
+  for (; p + 8 <= end; p += 8) h = rotl64(h ^ round64(0, read64(p)), 27) * PRIME1 + PRIME4;
+  if (p + 4 <= end) { h = rotl64(h ^ (read32(p) * PRIME1), 23) * PRIME2 + PRIME3; p += 4; }
+  for (; p < end; p++) h = rotl64(h ^ (*p * PRIME5), 11) * PRIME1;
+
+  h ^= h >> 33; h *= PRIME2;
+  h ^= h >> 29; h *= PRIME3;
+  h ^= h >> 32;
+
+  return h;
+}
+
+uint64_t rawcache_key(const void *bytes, size_t size, const uint32_t *params, uint32_t param_cnt) {
+  uint64_t key = xxh64(bytes, size, RAWCACHE_VERSION);
+  return xxh64((const uint8_t *) params, sizeof(uint32_t) * param_cnt, key);
+}
+
+static char *entry_path(uint64_t key) {
+  char dir[4096];
+  char *path = NULL;
+
+  if (!cache_dir_path(dir, sizeof(dir))) return NULL;
+  if (asprintf(&path, "%s/%016" PRIx64 ".raw", dir, key) == -1) return NULL;
+  return path;
+}
+
+static size_t entry_size(uint32_t pitch, uint32_t height) {
+  return RAWCACHE_HEADER_SIZE + (size_t) pitch * height;
+}
+
+bool rawcache_open(raw_frame *frame, uint64_t key, uint32_t width, uint32_t height, uint32_t pitch, uint32_t format) {
+  struct stat st;
+  bool ret = false;
+
+  memset(frame, 0, sizeof(raw_frame));
+
+  frame->path = entry_path(key);
+  if (!frame->path) return false;
+
+  int fd = open(frame->path, O_RDONLY | O_CLOEXEC);
+  if (fd == -1) goto exit_open; /* Plain miss */
+
+  if (fstat(fd, &st) == -1 || (size_t) st.st_size < entry_size(pitch, height)) goto exit_open;
+
+  frame->map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (frame->map == MAP_FAILED) { frame->map = NULL; goto exit_open; }
+  frame->map_size = st.st_size;
+
+  const rawcache_header *hdr = (const rawcache_header *) frame->map;
+  if (memcmp(hdr->magic, RAWCACHE_MAGIC, sizeof(hdr->magic)) || hdr->version != RAWCACHE_VERSION ||
+      hdr->header_size != RAWCACHE_HEADER_SIZE || hdr->key != key || hdr->width != width ||
+      hdr->height != height || hdr->format != format || hdr->pitch != pitch ||
+      hdr->data_size != (uint64_t) pitch * height) {
+    dlu_log_me(DLU_WARNING, "[x] %s does not match, ignoring it", frame->path);
+    goto exit_open;
+  }
+
+  frame->pixels = frame->map + hdr->header_size;
+  frame->bytes = hdr->data_size;
+  frame->pitch = pitch;
+
+  /* Marks the entry as recently used for eviction, failing only costs it its place */
+  futimens(fd, NULL);
+
+  /* It's about to be copied in one go */
+  madvise(frame->map, frame->map_size, MADV_WILLNEED);
+  ret = true;
+
+exit_open:
+  if (fd != -1) close(fd);
+  if (!ret) rawcache_close(frame);
+  return ret;
+}
+
+static void fill_header(rawcache_header *hdr, uint64_t key, uint32_t width, uint32_t height, uint32_t pitch, uint32_t format) {
+  memset(hdr, 0, sizeof(rawcache_header));
+  memcpy(hdr->magic, RAWCACHE_MAGIC, sizeof(hdr->magic));
+  hdr->version = RAWCACHE_VERSION;
+  hdr->header_size = RAWCACHE_HEADER_SIZE;
+  hdr->key = key;
+  hdr->width = width;
+  hdr->height = height;
+  hdr->format = format;
+  hdr->pitch = pitch;
+  hdr->data_size = (uint64_t) pitch * height;
+}
+
+bool rawcache_create(raw_frame *frame, uint64_t key, uint32_t width, uint32_t height, uint32_t pitch, uint32_t format) {
+  bool ret = false;
+  int fd = -1;
+
+  memset(frame, 0, sizeof(raw_frame));
+
+  frame->path = entry_path(key);
+  if (!frame->path) return false;
+
+  if (asprintf(&frame->tmp_path, "%s.XXXXXX", frame->path) == -1) { frame->tmp_path = NULL; goto exit_create; }
+
+  fd = mkostemp(frame->tmp_path, O_CLOEXEC);
+  if (fd == -1) {
+    dlu_log_me(DLU_WARNING, "[x] mkostemp: %s: %s", frame->tmp_path, strerror(errno));
+    free(frame->tmp_path); frame->tmp_path = NULL;
+    goto exit_create;
+  }
+
+  frame->map_size = entry_size(pitch, height);
+  if (ftruncate(fd, frame->map_size) == -1) {
+    dlu_log_me(DLU_WARNING, "[x] ftruncate: %s", strerror(errno));
+    goto exit_create;
+  }
+
+  frame->map = mmap(NULL, frame->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (frame->map == MAP_FAILED) {
+    dlu_log_me(DLU_WARNING, "[x] mmap: %s", strerror(errno));
+    frame->map = NULL;
+    goto exit_create;
+  }
+
+  /* Header is only written on commit, until then the file is just zeros up front */
+  fill_header(&frame->hdr, key, width, height, pitch, format);
+  frame->pixels = frame->map + RAWCACHE_HEADER_SIZE;
+  frame->bytes = frame->hdr.data_size;
+  frame->pitch = pitch;
+  ret = true;
+
+exit_create:
+  if (fd != -1) close(fd);
+  if (!ret) rawcache_close(frame);
+  return ret;
+}
+
+struct _entry {
+  char *name;
+  off_t size;
+  struct timespec used;
+};
+
+static int entry_cmp(const void *a, const void *b) {
+  const struct _entry *x = (const struct _entry *) a, *y = (const struct _entry *) b;
+  if (x->used.tv_sec != y->used.tv_sec) return (x->used.tv_sec < y->used.tv_sec) ? -1 : 1;
+  if (x->used.tv_nsec != y->used.tv_nsec) return (x->used.tv_nsec < y->used.tv_nsec) ? -1 : 1;
+  return 0;
+}
+
+/* Only committed *.raw files count, another run's half written temp file isn't touched */
+static bool is_entry(DIR *d, const struct dirent *de, struct stat *st) {
+  size_t len = strlen(de->d_name);
+  if (len < 4 || strcmp(de->d_name + len - 4, ".raw")) return false;
+  return fstatat(dirfd(d), de->d_name, st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISREG(st->st_mode);
+}
+
+/* Drops the least recently used entries until the rest fit in RAWCACHE_MAX_SIZE */
+static void cache_trim(void) {
+  struct _entry *entries = NULL;
+  uint32_t count = 0, cap = 0;
+  uint64_t total = 0;
+  struct dirent *de;
+  struct stat st;
+  char dir[4096];
+
+  if (!cache_dir_path(dir, sizeof(dir))) return;
+
+  DIR *d = opendir(dir);
+  if (!d) return;
+
+  while ((de = readdir(d))) {
+    if (!is_entry(d, de, &st)) continue;
+
+    if (count == cap) {
+      cap = (cap) ? cap * 2 : 32;
+      struct _entry *grown = realloc(entries, cap * sizeof(struct _entry));
+      if (!grown) { dlu_log_me(DLU_WARNING, "[x] realloc: %s", strerror(errno)); goto exit_trim; }
+      entries = grown;
+    }
+
+    entries[count].name = strdup(de->d_name);
+    if (!entries[count].name) goto exit_trim;
+    entries[count].size = st.st_size;
+    entries[count].used = st.st_mtim;
+    total += st.st_size;
+    count++;
+  }
+
+  if (total <= RAWCACHE_MAX_SIZE) goto exit_trim;
+
+  qsort(entries, count, sizeof(struct _entry), entry_cmp);
+  for (uint32_t i = 0; i < count && total > RAWCACHE_MAX_SIZE; i++) {
+    if (unlinkat(dirfd(d), entries[i].name, 0) == -1) continue;
+    total -= entries[i].size;
+    dlu_log_me(DLU_INFO, "Raw frame cache over %" PRIu64 " MiB, evicted %s", (uint64_t) RAWCACHE_MAX_SIZE >> 20, entries[i].name);
+  }
+
+exit_trim:
+  for (uint32_t i = 0; i < count; i++) free(entries[i].name);
+  free(entries);
+  closedir(d);
+}
+
+bool rawcache_has_room(uint32_t pitch, uint32_t height) {
+  uint64_t total = entry_size(pitch, height);
+  struct dirent *de;
+  struct stat st;
+  char dir[4096];
+
+  if (!cache_dir_path(dir, sizeof(dir))) return false;
+
+  DIR *d = opendir(dir);
+  if (!d) return false;
+
+  while (total <= RAWCACHE_MAX_SIZE && (de = readdir(d)))
+    if (is_entry(d, de, &st)) total += st.st_size;
+
+  closedir(d);
+  return total <= RAWCACHE_MAX_SIZE;
+}
+
+bool rawcache_commit(raw_frame *frame) {
+  if (!frame->tmp_path) return false;
+
+  memcpy(frame->map, &frame->hdr, sizeof(rawcache_header));
+
+  /* Data has to be on disk before the name is, else a crash can leave a valid looking header over zeros */
+  if (msync(frame->map, frame->map_size, MS_SYNC) == -1) {
+    dlu_log_me(DLU_WARNING, "[x] msync: %s: %s", frame->tmp_path, strerror(errno));
+    return false;
+  }
+
+  if (rename(frame->tmp_path, frame->path) == -1) {
+    dlu_log_me(DLU_WARNING, "[x] rename: %s: %s", frame->path, strerror(errno));
+    return false;
+  }
+
+  free(frame->tmp_path);
+  frame->tmp_path = NULL;
+
+  /* Same msync -> rename -> directory fsync order as cache_file_write(), the rename is durable too */
+  cache_dir_sync(frame->path);
+
+  cache_trim();
+  return true;
+}
+
+void rawcache_close(raw_frame *frame) {
+  if (frame->map) munmap(frame->map, frame->map_size);
+  if (frame->tmp_path) { unlink(frame->tmp_path); free(frame->tmp_path); }
+  free(frame->path);
+  memset(frame, 0, sizeof(raw_frame));
+}
@@ -0,0 +1,93 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#ifndef RAWCACHE_H
+#define RAWCACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+* On-disk cache of fully composed frames, so an image only has to be decoded
+* and scaled the first time it is shown. Files live in
+* $XDG_CACHE_HOME/lucurious-examples (or ~/.cache/...) and are named after
+* their key. Layout: one page holding rawcache_header, then height rows of
+* pitch bytes starting on a page boundary, ready to be copied into a BO.
+*
+* Entries add up to at most RAWCACHE_MAX_SIZE bytes. Every commit evicts the least
+* recently used ones past that, a hit counts as a use (its mtime is bumped, atime
+* can't be trusted under relatime or noatime).
+*/
+#define RAWCACHE_MAGIC "LUCRAWFB"
+#define RAWCACHE_VERSION 1
+#define RAWCACHE_HEADER_SIZE 4096
+#define RAWCACHE_MAX_SIZE (512ULL << 20)
+
+typedef struct _rawcache_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size; /* Offset of the first row */
+  uint64_t key;
+  uint32_t width;
+  uint32_t height;
+  uint32_t format; /* DRM fourcc */
+  uint32_t pitch;
+  uint64_t data_size;
+} rawcache_header;
+
+typedef struct _raw_frame {
+  uint8_t *pixels;
+  size_t bytes;
+  uint32_t pitch;
+
+  /* Internal */
+  rawcache_header hdr;
+  uint8_t *map;
+  size_t map_size;
+  char *path;
+  char *tmp_path; /* Set while a new entry is being written */
+} raw_frame;
+
+/* 64 bit hash of the source file, mixed with whatever else shapes the frame (size, format, scaling) */
+uint64_t rawcache_key(const void *bytes, size_t size, const uint32_t *params, uint32_t param_cnt);
+
+/* Map an existing entry read-only. Returns false on a miss or if the entry doesn't match */
+bool rawcache_open(raw_frame *frame, uint64_t key, uint32_t width, uint32_t height, uint32_t pitch, uint32_t format);
+
+/* Start a new entry, frame->pixels is writable until rawcache_commit() */
+bool rawcache_create(raw_frame *frame, uint64_t key, uint32_t width, uint32_t height, uint32_t pitch, uint32_t format);
+/**
+* Writes the header, flushes the entry to disk, renames it into place and fsyncs the
+* directory, so readers never see a partial file, not even after a crash. Then trims the cache to RAWCACHE_MAX_SIZE.
+*/
+bool rawcache_commit(raw_frame *frame);
+
+/* Whether a pitch x height entry still fits under RAWCACHE_MAX_SIZE without evicting anything */
+bool rawcache_has_room(uint32_t pitch, uint32_t height);
+
+/* Unmaps, and throws away an entry that was created but never committed */
+void rawcache_close(raw_frame *frame);
+
+#endif
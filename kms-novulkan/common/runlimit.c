@@ -0,0 +1,150 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/timerfd.h>
+
+#define LUCUR_DISPLAY_API
+#include <dluc/lucurious.h>
+
+#include "runlimit.h"
+
+void run_limit_init(run_limit *rl) {
+  memset(rl, 0, sizeof(run_limit));
+  rl->card = RUN_LIMIT_CARD;
+  rl->timerfd = -1;
+}
+
+bool run_limit_start(run_limit *rl) {
+  cpu_stat_now(&rl->start);
+  if (rl->seconds <= 0) return true;
+
+  rl->timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (rl->timerfd == -1) {
+    dlu_log_me(DLU_DANGER, "[x] timerfd_create: %s", strerror(errno));
+    return false;
+  }
+
+  struct itimerspec its;
+  memset(&its, 0, sizeof(its));
+  its.it_value.tv_sec = (time_t) rl->seconds;
+  its.it_value.tv_nsec = (long) ((rl->seconds - (double) its.it_value.tv_sec) * 1e9);
+  if (!its.it_value.tv_sec && !its.it_value.tv_nsec) its.it_value.tv_nsec = 1;
+
+  if (timerfd_settime(rl->timerfd, 0, &its, NULL) == -1) {
+    dlu_log_me(DLU_DANGER, "[x] timerfd_settime: %s", strerror(errno));
+    return false;
+  }
+
+  return true;
+}
+
+void run_limit_fini(run_limit *rl) {
+  if (rl->timerfd >= 0) close(rl->timerfd);
+  rl->timerfd = -1;
+}
+
+bool run_limit_reached(const run_limit *rl, uint64_t frames) {
+  if (rl->frames && frames >= rl->frames) return true;
+
+  if (rl->seconds <= 0) return false;
+
+  /* vDSO clock read, cheap enough for every frame of a busy loop that never sees the timer */
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9 - rl->start.wall >= rl->seconds;
+}
+
+/* Names come from connectors and the command line, quotes and control characters are escaped */
+static void json_string(FILE *out, const char *str) {
+  fputc('"', out);
+  for (; *str; str++) {
+    unsigned char c = (unsigned char) *str;
+    if (c == '"' || c == '\\') fprintf(out, "\\%c", c);
+    else if (c < 0x20) fprintf(out, "\\u%04x", c);
+    else fputc(c, out);
+  }
+  fputc('"', out);
+}
+
+void run_limit_summary_begin(run_limit *rl, const char *example) {
+  rl->summary_outputs = 0;
+  rl->json = stdout;
+
+  /* A file of its own, so nothing else written to stdout can end up in the middle of the JSON */
+  if (rl->json_path && strcmp(rl->json_path, "-")) {
+    rl->json = fopen(rl->json_path, "w");
+    if (!rl->json) { dlu_log_me(DLU_DANGER, "[x] fopen: %s: %s", rl->json_path, strerror(errno)); return; }
+  }
+
+  fprintf(rl->json, "{\"example\":");
+  json_string(rl->json, example);
+  fprintf(rl->json, ",\"card\":");
+  json_string(rl->json, rl->card);
+  fprintf(rl->json, ",\"outputs\":[");
+}
+
+void run_limit_summary_output(run_limit *rl, const char *name, const flip_rec *flips) {
+  if (!rl->json) return;
+
+  flip_stats stats;
+  flip_rec_stats(flips, &stats);
+
+  fprintf(rl->json, "%s{\"name\":", (rl->summary_outputs++) ? "," : "");
+  json_string(rl->json, name);
+  fprintf(rl->json, ",\"flips\":%" PRIu64 ",\"analysed\":%" PRIu64 ",\"skipped_vblanks\":%" PRIu64 ",\"period_ms\":%.4f",
+          stats.count, stats.kept, stats.skipped, stats.period);
+  fprintf(rl->json, ",\"interval_ms\":{\"min\":%.4f,\"p50\":%.4f,\"p90\":%.4f,\"p99\":%.4f,\"p99.9\":%.4f,\"max\":%.4f}",
+          stats.min, stats.p50, stats.p90, stats.p99, stats.p999, stats.max);
+
+  /* Bucket i holds the intervals whose jitter is below bound i and at or above bound i - 1 */
+  fprintf(rl->json, ",\"jitter_ms\":{\"bounds\":[");
+  for (uint32_t b = 0; b < FLIP_JITTER_BUCKETS - 1; b++)
+    fprintf(rl->json, "%s%g", (b) ? "," : "", flip_jitter_bounds[b]);
+  fprintf(rl->json, "],\"counts\":[");
+  for (uint32_t b = 0; b < FLIP_JITTER_BUCKETS; b++)
+    fprintf(rl->json, "%s%" PRIu64, (b) ? "," : "", stats.jitter[b]);
+  fprintf(rl->json, "]}}");
+}
+
+void run_limit_summary_end(run_limit *rl, uint64_t frames) {
+  if (!rl->json) return;
+
+  cpu_stat end;
+  cpu_stat_now(&end);
+
+  double wall = end.wall - rl->start.wall, user = end.user - rl->start.user, sys = end.sys - rl->start.sys;
+  double cpu = user + sys;
+
+  fprintf(rl->json, "],\"frames\":%" PRIu64 ",\"wall_s\":%.4f,\"cpu\":{\"user_s\":%.4f,\"sys_s\":%.4f,\"core_pct\":%.2f,\"ms_per_frame\":%.4f}}\n",
+          frames, wall, user, sys, (wall > 0) ? cpu / wall * 100.0 : 0, (frames) ? cpu / frames * 1e3 : 0);
+  if (rl->json == stdout) fflush(stdout);
+  else if (fclose(rl->json) == EOF) dlu_log_me(DLU_DANGER, "[x] fclose: %s: %s", rl->json_path, strerror(errno));
+  rl->json = NULL;
+}
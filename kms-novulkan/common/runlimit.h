@@ -0,0 +1,74 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#ifndef RUNLIMIT_H
+#define RUNLIMIT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "cpustat.h"
+#include "fliprec.h"
+
+#define RUN_LIMIT_CARD "/dev/dri/card0"
+
+/**
+* Unattended runs, for catching frame pacing regressions in CI on machines with
+* no GPU or monitor (vkms). A run can stop after a number of frames, a number of
+* seconds or whichever comes first. Headless runs skip the logind session and
+* libinput, there's no seat to take over and nobody at the keyboard, and write a
+* one line JSON summary of frame times and CPU time on exit, to json_path when
+* one is given (-J) or else to stdout.
+*/
+typedef struct _run_limit {
+  const char *card; /* KMS node to open */
+  bool headless;
+  const char *json_path; /* Where the summary goes, NULL or "-" = stdout */
+  FILE *json;
+  uint64_t frames; /* Flips every output has to complete, 0 = no limit */
+  double seconds; /* 0 = no limit */
+  int timerfd; /* Fires once seconds ran out, so a stalled output can't hang the run */
+  cpu_stat start;
+  uint32_t summary_outputs;
+} run_limit;
+
+void run_limit_init(run_limit *rl);
+
+/* Starts the clocks and, with a time limit, the timer. Call right before the first frame */
+bool run_limit_start(run_limit *rl);
+void run_limit_fini(run_limit *rl);
+
+/* frames is the fewest flips any output has completed */
+bool run_limit_reached(const run_limit *rl, uint64_t frames);
+
+/**
+* The summary is written in pieces since every example keeps its outputs its own way:
+* begin, one run_limit_summary_output() per output, then end with the frame total.
+*/
+void run_limit_summary_begin(run_limit *rl, const char *example);
+void run_limit_summary_output(run_limit *rl, const char *name, const flip_rec *flips);
+void run_limit_summary_end(run_limit *rl, uint64_t frames);
+
+#endif
@@ -0,0 +1,375 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <time.h>
+#include <glob.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+
+#include <drm_fourcc.h>
+
+#define LUCUR_DISPLAY_API
+#include <dluc/lucurious.h>
+
+#include "slideshow.h"
+#include "spscq.h"
+#include "imgload.h"
+#include "rawcache.h"
+
+struct _slideshow {
+  char **paths;
+  uint32_t count;
+  blit_surface dst;
+  blit_fit fit;
+  blit_filter filter;
+  bool use_cache;
+
+  slide *slides;
+  uint32_t slide_cnt;
+
+  spsc_queue ready; /* Decoder -> display */
+  spsc_queue free;  /* Display -> decoder */
+  sem_t free_cnt;   /* Slides in the free queue, the decoder sleeps on it */
+  sem_t ready_cnt;  /* Posted per ready slide and when the decoder ends, slideshow_first() sleeps on it */
+
+  pthread_t thread;
+  bool started;
+  atomic_bool stop;
+  atomic_bool finished; /* Decoder gave up */
+
+  /* Only touched by the display side */
+  slide *cur;
+  double interval;
+  double due;
+  bool waiting;
+  uint64_t shown;
+  uint64_t late;
+  uint64_t dropped;
+
+  atomic_uint_fast64_t failed;
+};
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int compare_paths(const void *a, const void *b) {
+  return strcmp(*(char * const *) a, *(char * const *) b);
+}
+
+char **slideshow_list(const char *pattern, uint32_t *count) {
+  struct stat st;
+  glob_t found;
+  char *dir_pattern = NULL;
+  char **paths = NULL;
+
+  *count = 0;
+
+  /* A plain file name may well contain glob characters */
+  if (stat(pattern, &st) == 0 && S_ISREG(st.st_mode)) {
+    paths = calloc(1, sizeof(char *));
+    if (!paths || !(paths[0] = strdup(pattern))) { dlu_log_me(DLU_DANGER, "[x] %s", strerror(errno)); free(paths); return NULL; }
+    *count = 1;
+    return paths;
+  }
+
+  if (stat(pattern, &st) == 0 && S_ISDIR(st.st_mode)) {
+    if (asprintf(&dir_pattern, "%s/*", pattern) == -1) return NULL;
+    pattern = dir_pattern;
+  }
+
+  int err = glob(pattern, 0, NULL, &found);
+  if (err) {
+    dlu_log_me(DLU_DANGER, "[x] No images match %s", pattern);
+    free(dir_pattern);
+    return NULL;
+  }
+
+  paths = calloc(found.gl_pathc, sizeof(char *));
+  if (!paths) { dlu_log_me(DLU_DANGER, "[x] calloc: %s", strerror(errno)); goto exit_list; }
+
+  /* Subdirectories and such would only ever fail to decode */
+  for (size_t i = 0; i < found.gl_pathc; i++) {
+    if (stat(found.gl_pathv[i], &st) == -1 || !S_ISREG(st.st_mode)) continue;
+    paths[*count] = strdup(found.gl_pathv[i]);
+    if (!paths[*count]) { slideshow_list_free(paths, *count); paths = NULL; *count = 0; goto exit_list; }
+    (*count)++;
+  }
+
+  if (!*count) {
+    dlu_log_me(DLU_DANGER, "[x] No images match %s", pattern);
+    free(paths); paths = NULL;
+    goto exit_list;
+  }
+
+  qsort(paths, *count, sizeof(char *), compare_paths);
+
+exit_list:
+  globfree(&found);
+  free(dir_pattern);
+  return paths;
+}
+
+void slideshow_list_free(char **paths, uint32_t count) {
+  if (!paths) return;
+  for (uint32_t i = 0; i < count; i++)
+    free(paths[i]);
+  free(paths);
+}
+
+static bool stream_row(void *data, uint32_t y, const uint32_t *row) {
+  return blit_stream_row((blit_stream *) data, y, row);
+}
+
+/* Runs on the decode thread, same steps upload_image() takes for a single image */
+static bool decode_slide(slideshow *show, const char *path, uint8_t *pixels) {
+  blit_surface dst = show->dst;
+  size_t bytes = (size_t) dst.pitch * dst.height;
+  uint32_t width = 0, height = 0;
+  uint64_t key = 0;
+  raw_frame cached;
+  img_file file;
+  bool ret = false;
+
+  memset(&file, 0, sizeof(img_file));
+  if (!img_file_map(&file, path)) return false;
+
+  if (show->use_cache) {
+    uint32_t params[] = { dst.width, dst.height, dst.pitch, DRM_FORMAT_XRGB8888, show->fit, show->filter };
+    key = rawcache_key(file.bytes, file.size, params, sizeof(params) / sizeof(params[0]));
+
+    if (rawcache_open(&cached, key, dst.width, dst.height, dst.pitch, DRM_FORMAT_XRGB8888)) {
+      memcpy(pixels, cached.pixels, bytes);
+      rawcache_close(&cached);
+      ret = true;
+      goto exit_decode;
+    }
+  }
+
+  if (!img_probe(&file, &width, &height)) goto exit_decode;
+
+  dst.pixels = pixels;
+  blit_stream *stream = blit_stream_create(&dst, width, height, show->fit, show->filter, 0);
+  if (!stream) goto exit_decode;
+
+  ret = img_decode_rows(&file, stream_row, stream) && blit_stream_done(stream);
+  blit_stream_destroy(stream);
+
+  if (ret && show->use_cache && rawcache_has_room(dst.pitch, dst.height) &&
+      rawcache_create(&cached, key, dst.width, dst.height, dst.pitch, DRM_FORMAT_XRGB8888)) {
+    memcpy(cached.pixels, pixels, bytes);
+    rawcache_commit(&cached);
+    rawcache_close(&cached);
+  }
+
+exit_decode:
+  img_file_unmap(&file);
+  return ret;
+}
+
+static void *decoder_main(void *arg) {
+  slideshow *show = (slideshow *) arg;
+  uint32_t failures = 0;
+  slide *s = NULL;
+
+  for (uint64_t seq = 0; ; seq++) {
+    if (!s) {
+      while (sem_wait(&show->free_cnt) == -1 && errno == EINTR);
+      if (atomic_load(&show->stop)) break;
+      s = (slide *) spscq_pop(&show->free);
+    }
+
+    const char *path = show->paths[seq % show->count];
+    if (!decode_slide(show, path, s->pixels)) {
+      if (seq < show->count) dlu_log_me(DLU_WARNING, "[x] Skipping %s", path); /* Once, not every loop */
+      atomic_fetch_add(&show->failed, 1);
+
+      /* Keeps the slot and moves on, unless every single image is broken */
+      if (++failures == show->count) {
+        dlu_log_me(DLU_DANGER, "[x] None of the images could be decoded");
+        break;
+      }
+      continue;
+    }
+
+    failures = 0;
+    s->seq = seq;
+    spscq_push(&show->ready, s); /* Can't be full, it has room for every slide */
+    sem_post(&show->ready_cnt);
+    s = NULL;
+  }
+
+  atomic_store(&show->finished, true);
+  sem_post(&show->ready_cnt); /* Wakes slideshow_first() if nothing ever got decoded */
+  return NULL;
+}
+
+slideshow *slideshow_create(char **paths, uint32_t count, const blit_surface *dst, blit_fit fit, blit_filter filter,
+                            double interval, uint32_t ahead, bool use_cache) {
+  slideshow *show = calloc(1, sizeof(slideshow));
+  if (!show) { dlu_log_me(DLU_DANGER, "[x] calloc: %s", strerror(errno)); return NULL; }
+
+  show->paths = paths;
+  show->count = count;
+  show->dst = *dst;
+  show->fit = fit;
+  show->filter = filter;
+  show->use_cache = use_cache;
+  show->interval = interval;
+  atomic_init(&show->stop, false);
+  atomic_init(&show->finished, false);
+  atomic_init(&show->failed, 0);
+
+  /* The queued ones, the one on screen and the one being decoded */
+  show->slide_cnt = ahead + 2;
+
+  if (!spscq_init(&show->ready, show->slide_cnt)) goto err_destroy;
+  if (!spscq_init(&show->free, show->slide_cnt)) goto err_destroy;
+
+  show->slides = calloc(show->slide_cnt, sizeof(slide));
+  if (!show->slides) { dlu_log_me(DLU_DANGER, "[x] calloc: %s", strerror(errno)); goto err_destroy; }
+
+  size_t bytes = (size_t) dst->pitch * dst->height;
+  for (uint32_t i = 0; i < show->slide_cnt; i++) {
+    show->slides[i].pixels = aligned_alloc(64, (bytes + 63) & ~(size_t) 63);
+    if (!show->slides[i].pixels) { dlu_log_me(DLU_DANGER, "[x] aligned_alloc: %s", strerror(errno)); goto err_destroy; }
+    spscq_push(&show->free, &show->slides[i]);
+  }
+
+  if (sem_init(&show->free_cnt, 0, show->slide_cnt) == -1) {
+    dlu_log_me(DLU_DANGER, "[x] sem_init: %s", strerror(errno));
+    goto err_destroy;
+  }
+
+  if (sem_init(&show->ready_cnt, 0, 0) == -1) {
+    dlu_log_me(DLU_DANGER, "[x] sem_init: %s", strerror(errno));
+    sem_destroy(&show->free_cnt);
+    goto err_destroy;
+  }
+
+  int err = pthread_create(&show->thread, NULL, decoder_main, show);
+  if (err) {
+    dlu_log_me(DLU_DANGER, "[x] pthread_create: %s", strerror(err));
+    sem_destroy(&show->free_cnt); sem_destroy(&show->ready_cnt);
+    goto err_destroy;
+  }
+  show->started = true;
+
+  return show;
+
+err_destroy:
+  slideshow_destroy(show);
+  return NULL;
+}
+
+void slideshow_destroy(slideshow *show) {
+  if (!show) return;
+
+  if (show->started) {
+    atomic_store(&show->stop, true);
+    sem_post(&show->free_cnt);
+    pthread_join(show->thread, NULL);
+    sem_destroy(&show->free_cnt);
+    sem_destroy(&show->ready_cnt);
+
+    dlu_log_me(DLU_INFO, "Slideshow: %" PRIu64 " shown, %" PRIu64 " late, %" PRIu64 " dropped, %" PRIu64 " failed to decode",
+               show->shown, show->late, show->dropped, (uint64_t) atomic_load(&show->failed));
+  }
+
+  if (show->slides)
+    for (uint32_t i = 0; i < show->slide_cnt; i++)
+      free(show->slides[i].pixels);
+
+  free(show->slides);
+  spscq_free(&show->ready);
+  spscq_free(&show->free);
+  free(show);
+}
+
+static void release_slide(slideshow *show, slide *s) {
+  spscq_push(&show->free, s);
+  sem_post(&show->free_cnt); /* Never blocks */
+}
+
+slide *slideshow_first(slideshow *show) {
+  slide *s = NULL;
+
+  /* Only called before anything else pops, so a post means a slide is there or the decoder is done */
+  while (!(s = (slide *) spscq_pop(&show->ready))) {
+    if (atomic_load(&show->finished)) {
+      /* The last push may have landed between the pop and the load */
+      if (!(s = (slide *) spscq_pop(&show->ready))) return NULL;
+      break;
+    }
+    while (sem_wait(&show->ready_cnt) == -1 && errno == EINTR);
+  }
+
+  show->cur = s;
+  show->shown = 1;
+  show->due = now_seconds() + show->interval;
+  return s;
+}
+
+slide *slideshow_poll(slideshow *show) {
+  double now = now_seconds();
+
+  if (now < show->due) return NULL;
+
+  slide *next = (slide *) spscq_pop(&show->ready), *later = NULL;
+  if (!next) {
+    /* Keep the old slide up, counted once no matter how many flips it takes */
+    if (!show->waiting) { show->late++; show->waiting = true; }
+    return NULL;
+  }
+
+  /* A whole interval behind (the handler wasn't called for a while), jump to the slide that belongs on screen */
+  while (now >= show->due + show->interval && (later = (slide *) spscq_pop(&show->ready))) {
+    release_slide(show, next);
+    show->dropped++;
+    show->due += show->interval;
+    next = later;
+  }
+
+  release_slide(show, show->cur);
+  show->cur = next;
+  show->shown++;
+  show->waiting = false;
+
+  /* A late slide still gets its full interval */
+  show->due += show->interval;
+  if (show->due <= now) show->due = now + show->interval;
+
+  return next;
+}
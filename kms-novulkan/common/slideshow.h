@@ -0,0 +1,71 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#ifndef SLIDESHOW_H
+#define SLIDESHOW_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "blit.h"
+
+/**
+* Cycles through a list of images. A decode thread stays up to `ahead` slides
+* in front of the display and hands finished frames over through a lock-free
+* queue, so slideshow_poll() never waits on I/O or the decoder and can be
+* called straight from a page-flip handler. Frames are composed for the mode
+* (XRGB8888, rows pitch bytes apart). With use_cache hits are read from the raw
+* frame cache like a single image's, but a slide is only written to it while there is
+* room under the cap: a long show never evicts entries to make space for itself.
+*/
+typedef struct _slide {
+  uint8_t *pixels;
+  uint64_t seq; /* Position in the show, keeps counting across loops */
+} slide;
+
+typedef struct _slideshow slideshow;
+
+/* A directory lists every file in it, anything else is taken as a glob(3) pattern. Sorted */
+char **slideshow_list(const char *pattern, uint32_t *count);
+void slideshow_list_free(char **paths, uint32_t count);
+
+/* paths must outlive the show. Returns NULL on failure */
+slideshow *slideshow_create(char **paths, uint32_t count, const blit_surface *dst, blit_fit fit, blit_filter filter,
+                            double interval, uint32_t ahead, bool use_cache);
+
+/* Logs how many slides were shown, late, dropped or failed to decode */
+void slideshow_destroy(slideshow *show);
+
+/* Blocks until the first slide is decoded and starts the clock. NULL if nothing could be decoded */
+slide *slideshow_first(slideshow *show);
+
+/**
+* Never blocks. Returns the slide that should be up now if it changed since the
+* last call, NULL otherwise. The previous slide is recycled at that point.
+* Late = a slide was due but the decoder hadn't finished it yet.
+* Dropped = the display fell a whole interval behind and a decoded slide was skipped.
+*/
+slide *slideshow_poll(slideshow *show);
+
+#endif
@@ -0,0 +1,77 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include "spscq.h"
+
+bool spscq_init(spsc_queue *queue, uint32_t capacity) {
+  uint32_t size = 1;
+
+  while (size < capacity) size <<= 1;
+
+  queue->slots = calloc(size, sizeof(void *));
+  if (!queue->slots) { fprintf(stderr, "[x] calloc: %s\n", strerror(errno)); return false; }
+
+  queue->mask = size - 1;
+  atomic_init(&queue->head, 0);
+  atomic_init(&queue->tail, 0);
+
+  return true;
+}
+
+void spscq_free(spsc_queue *queue) {
+  free(queue->slots);
+  queue->slots = NULL;
+}
+
+bool spscq_push(spsc_queue *queue, void *item) {
+  uint32_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+  uint32_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+
+  if (tail - head > queue->mask) return false;
+
+  queue->slots[tail & queue->mask] = item;
+
+  /* Publishes the slot, pairs with the acquire in spscq_pop() */
+  atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+  return true;
+}
+
+void *spscq_pop(spsc_queue *queue) {
+  uint32_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+  uint32_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+
+  if (head == tail) return NULL;
+
+  void *item = queue->slots[head & queue->mask];
+
+  /* Hands the slot back to the producer only after it has been read */
+  atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+  return item;
+}
@@ -0,0 +1,57 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#ifndef SPSCQ_H
+#define SPSCQ_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+
+/**
+* Bounded lock-free queue of pointers for exactly one producer thread and one
+* consumer thread. Neither side ever blocks or takes a lock, so it is safe to
+* use from a page-flip handler.
+*/
+typedef struct _spsc_queue {
+  void **slots;
+  uint32_t mask;
+
+  /* Kept on their own cache lines so the two threads don't bounce one between them */
+  alignas(64) atomic_uint head; /* Next slot to pop, only written by the consumer */
+  alignas(64) atomic_uint tail; /* Next slot to push, only written by the producer */
+} spsc_queue;
+
+/* Capacity is rounded up to a power of two */
+bool spscq_init(spsc_queue *queue, uint32_t capacity);
+void spscq_free(spsc_queue *queue);
+
+/* Returns false when the queue is full */
+bool spscq_push(spsc_queue *queue, void *item);
+
+/* Returns NULL when the queue is empty */
+void *spscq_pop(spsc_queue *queue);
+
+#endif
@@ -32,13 +32,29 @@
 #include <errno.h>
 #include <stdbool.h>
 #include <unistd.h>
+#include <getopt.h>
+#include <signal.h>
 #include <sys/mman.h>
-#include <sys/epoll.h>
+
+#include <drm_fourcc.h>
 
 /* For Libinput input event codes */
 #include <linux/input-event-codes.h>
 
 #include "simple_example.h"
+#include "fill.h"
+#include "fillpool.h"
+#include "bomap.h"
+#include "blit.h"
+#include "imgload.h"
+#include "imgupload.h"
+#include "quit.h"
+#include "rawcache.h"
+#include "fliprec.h"
+#include "evloop.h"
+#include "cpustat.h"
+#include "runlimit.h"
+#include "kmsretry.h"
 
 #define UNUSED __attribute__((unused))
 
@@ -46,15 +62,28 @@ struct _map_info {
   bool is_image;
   uint8_t *pixel_data;
   size_t bytes;
+  bool zero_copy;
+  bool dumb; /* Scan out of dumb buffers filled with streaming stores instead of the GBM BOs */
+  dumb_buf dumbs[2]; /* The scanout buffers when dumb is set */
+  bo_map *maps; /* One persistent CPU mapping per scanout BO when zero_copy is set */
+  uint32_t threads;
+  fill_pool *pool; /* NULL when filling on the main thread only */
+  img_file img; /* Read-only mapping of the image file, decoded in upload_image() */
+  uint32_t img_width;
+  uint32_t img_height;
+  blit_fit fit;
+  blit_filter filter;
+  bool use_cache; /* Keep composed images in the raw frame cache */
+  bool modeset_loop; /* The old way, a modeset per frame in a busy loop. Kept to compare CPU use */
+  uint8_t front_buf; /* BO being scanned out */
+  flip_rec flips; /* Every flip completion, reported on exit */
+  run_limit limit; /* Card, frame and time limits, headless CI runs */
+  kms_retry retry; /* Resubmits a flip the kernel turned down */
+  char name[32]; /* Connector, for the summary */
 } map_info;
 
 dlu_otma_mems ma = { .drmc_cnt = 1, .dod_cnt = 1, .dob_cnt = 2 };
 
-static inline void init_epoll_values(struct epoll_event *event) {
-  event->events = 0; event->data.ptr = NULL; event->data.fd = 0;
-  event->data.u32 = 0; event->data.u64 = 0;
-}
-
 static bool init_buffs(dlu_disp_core *core) {
   bool err;
 
@@ -66,7 +95,48 @@ static bool init_buffs(dlu_disp_core *core) {
 
   return err;
 }
+
+/* Map every scanout BO once so draw_screen can render straight into the back buffer */
+static bool map_buffs(dlu_disp_core *core) {
+  map_info.maps = calloc(ma.dob_cnt, sizeof(bo_map));
+  if (!map_info.maps) { dlu_log_me(DLU_DANGER, "[x] calloc: %s", strerror(errno)); return false; }
+
+  for (uint32_t i = 0; i < ma.dob_cnt; i++) {
+    uint32_t width = core->output_data[0].mode.hdisplay, height = core->output_data[0].mode.vdisplay;
+    if (map_info.dumb ? !bo_map_create_dumb(&map_info.maps[i], core->device.kmsfd, &map_info.dumbs[i])
+                      : !bo_map_create(&map_info.maps[i], core->buff_data[i].bo, width, height))
+      return false;
+  }
+
+  return true;
+}
+
+static void unmap_buffs(void) {
+  if (!map_info.maps) return;
+  for (uint32_t i = 0; i < ma.dob_cnt; i++)
+    bo_map_destroy(&map_info.maps[i]);
+  free(map_info.maps); map_info.maps = NULL;
+}
  
+/* Decodes the image into both BOs, see img_upload_run() */
+static bool upload_image(dlu_disp_core *core) {
+  blit_surface dst = { NULL, core->output_data[0].mode.hdisplay, core->output_data[0].mode.vdisplay, core->buff_data[0].pitches[0] };
+  img_upload up = {
+    .img = &map_info.img, .img_width = map_info.img_width, .img_height = map_info.img_height,
+    .fit = map_info.fit, .filter = map_info.filter, .use_cache = map_info.use_cache,
+    .name = NULL, .count = ma.dob_cnt, .buffs = core->buff_data,
+    .maps = (map_info.zero_copy) ? map_info.maps : NULL
+  };
+
+  bool ret = img_upload_run(&up, &dst);
+  img_file_unmap(&map_info.img);
+
+  /* Nothing will be written into the buffers again */
+  unmap_buffs();
+
+  return ret;
+}
+
 /* Taken from: https://github.com/dvdhrm/docs/blob/master/drm-howto/modeset-double-buffered.c */
 static uint8_t next_color(bool *up, uint8_t cur, unsigned int mod) {
   uint8_t next;
@@ -80,11 +150,20 @@ static uint8_t next_color(bool *up, uint8_t cur, unsigned int mod) {
   return next;
 }
 
-static void draw_screen(dlu_disp_core *core) {
-  static uint8_t r, g, b, front_buf = 0;
+static void draw_screen(dlu_disp_core *core, uint8_t idx) {
+  static uint8_t r, g, b;
   static bool r_up = true, g_up = true, b_up = true, run_once = false;
 
-  if (map_info.is_image) goto display;
+  bo_map *map = NULL;
+
+  /* Every BO already holds the image, all that's left is to flip between them */
+  if (map_info.is_image) return;
+
+  /* Let the kernel know the CPU is about to write into the back buffer */
+  if (map_info.zero_copy) {
+    map = &map_info.maps[idx];
+    if (!bo_map_begin(map)) return;
+  }
 
   if (!run_once) {
     srand(time(NULL));
@@ -98,71 +177,234 @@ static void draw_screen(dlu_disp_core *core) {
   g = next_color(&g_up, g, 10);
   b = next_color(&b_up, b, 5);
 
-  for (uint32_t j = 0; j <  core->output_data[0].mode.vdisplay; j++)
-    for (uint32_t k = 0; k < core->output_data[0].mode.hdisplay; k++) /* pitch = stride */
-      *(uint32_t *) &map_info.pixel_data[core->buff_data[0].pitches[0] * j + k * 4] = (r << 16) | (g << 8) | b;
+  /* pitch = stride = width of a row in bytes, including any padding the driver added */
+  uint8_t *pixels = (map) ? map->pixels : map_info.pixel_data;
+  uint32_t pitch = (map) ? map->stride : core->buff_data[0].pitches[0];
 
-display:
-  dlu_fb_gbm_bo_write(core->buff_data[front_buf^1].bo, map_info.pixel_data, map_info.bytes);
+  /* Returns once every band is written, so the buffer is complete before it's queued */
+  fill_pool_rect32(map_info.pool, pixels, pitch, core->output_data[0].mode.hdisplay,
+                   core->output_data[0].mode.vdisplay, (r << 16) | (g << 8) | b);
 
-  if (!dlu_kms_modeset(core, front_buf^1)) return;
-  front_buf ^= 1;
+  if (map) bo_map_end(map);
+  else dlu_fb_gbm_bo_write(core->buff_data[idx].bo, map_info.pixel_data, map_info.bytes);
 }
 
-static void handle_screen(dlu_disp_core *core, const char *image) {
-  if (image) {
-    dlu_file_info picture = dlu_read_file(image);
-    if (!picture.bytes) goto exit_func;
-
-    int pw = 0, ph = 0, pchannels = 0, requested_channels = STBI_rgb_alpha;
-    map_info.pixel_data = stbi_load_from_memory((unsigned char *) picture.bytes, picture.byte_size, &pw, &ph, &pchannels, requested_channels);
-    if (!map_info.pixel_data) {
-      dlu_log_me(DLU_DANGER, "[x] %s", stbi_failure_reason());
-      free(picture.bytes);
-      goto exit_func;
-    }
+/* Hands the finished back buffer to the kernel */
+static void present(dlu_disp_core *core) {
+  if (dlu_kms_page_flip(core, map_info.front_buf^1, core)) return;
 
-    map_info.is_image = true;
-    free(picture.bytes);
+  /* No event is coming for a flip that was turned down, the retry timer submits it again */
+  kms_retry_arm(&map_info.retry);
+}
 
-    if (pw != core->output_data[0].mode.hdisplay) {
-      dlu_log_me(DLU_DANGER, "[x] For now the picture pixel width must be picture must be the \
-                           same amount of pixels the monitor will allow (%u)", core->output_data[0].mode.hdisplay);
-      goto exit_func;
-    }
+/* The flip to the back buffer completed, it's the front now. Draw the next frame into the other one */
+static void page_flip_event(int UNUSED fd, unsigned int frame, unsigned int sec, unsigned int usec, void *data) {
+  dlu_disp_core *core = (dlu_disp_core *) data;
 
-    /* Calculate image size in bytes */
-    map_info.bytes = core->output_data[0].mode.hdisplay * core->output_data[0].mode.vdisplay * (requested_channels <= 0 ? pchannels : requested_channels); 
-  } else {
-    /* Create space to assign pixel data to */
-    map_info.bytes = core->output_data[0].mode.hdisplay * core->output_data[0].mode.vdisplay * 4; /* 4 bytes = 32 bit, R = 8 bits, G = 8 bits, B = 8 bits, A = 8 bits */
-    map_info.pixel_data = mmap(NULL, map_info.bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, INDEX_IGNORE, core->buff_data[0].offsets[0]);
-    if (map_info.pixel_data == MAP_FAILED) { dlu_log_me(DLU_DANGER, "[x] %s", strerror(errno)); goto exit_func; }
-  }
+  core->output_data[0].pflip = false;
+  flip_rec_add(&map_info.flips, frame, sec, usec);
+  map_info.front_buf ^= 1;
+
+  draw_screen(core, map_info.front_buf^1);
+  present(core);
+}
+
+/* A flip was turned down, the back buffer is still drawn so submit it again */
+static bool retry_ready(ev_source *src) {
+  kms_retry_fired(&map_info.retry);
+  src->syscalls++;
 
+  present((dlu_disp_core *) src->data);
+  return true;
+}
+
+/* Redraws and modesets as fast as the CPU allows, no matter the refresh rate. Returns the frames shown */
+static uint64_t modeset_loop(dlu_disp_core *core) {
   uint32_t key_code = UINT32_MAX;
+  uint64_t frames = 0;
+
   while(1) {
-    draw_screen(core);
-    if (dlu_input_retrieve(core, &key_code)) {
+    draw_screen(core, map_info.front_buf^1);
+    if (!dlu_kms_modeset(core, map_info.front_buf^1)) return frames;
+    map_info.front_buf ^= 1;
+    frames++;
+
+    if (caught_signal == SIGINT || caught_signal == SIGTERM) return frames;
+    if (run_limit_reached(&map_info.limit, frames)) return frames;
+
+    if (!map_info.limit.headless && dlu_input_retrieve(core, &key_code)) {
       switch(key_code) {
-        case KEY_ESC: goto exit_func; break;
-        case KEY_Q: goto exit_func; break;
+        case KEY_ESC: return frames;
+        case KEY_Q: return frames;
         default: break;
       }
     }
   }
+}
 
-exit_func:
-  if (map_info.pixel_data) {
-    if (image) stbi_image_free(map_info.pixel_data);
-    else munmap(map_info.pixel_data, map_info.bytes);
+/* The time limit ran out, leave even if flips stopped coming */
+static bool limit_ready(ev_source *src) {
+  src->syscalls++;
+  return false;
+}
+
+static void summary(uint64_t frames) {
+  run_limit_summary_begin(&map_info.limit, "double-buffer");
+  run_limit_summary_output(&map_info.limit, map_info.name, &map_info.flips);
+  run_limit_summary_end(&map_info.limit, frames);
+}
+
+/* Every pending DRM event (flip completions) in as few reads as possible */
+static bool kms_ready(ev_source *src) {
+  return ev_drain_drm(src, (drmEventContext *) src->data);
+}
+
+static void handle_screen(dlu_disp_core *core, const char *image) {
+  ev_loop loop;
+  cpu_stat start;
+
+  /* Version 2 introduced the page_flip_handler, so we use that */
+  drmEventContext ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.version = 2;
+  ev.page_flip_handler = page_flip_event;
+
+  catch_signals();
+
+  if (map_info.dumb) {
+    /* Dumb mappings are write-combined, streaming stores fill them without touching the cache */
+    fill_set_kernel(fill_stream_kernel());
+    dlu_log_me(DLU_INFO, "Scanning out of dumb buffers, filling with the %s kernel", fill_kernel_name(fill_get_kernel()));
+  }
+
+  if (image) {
+    /* Decoded straight from the page cache in upload_image(), the encoded bytes are never copied */
+    if (!img_file_map(&map_info.img, image)) goto exit_func;
+
+    /* Any size goes, upload_image() crops, letterboxes or scales it into the BOs */
+    if (!img_probe(&map_info.img, &map_info.img_width, &map_info.img_height)) goto exit_func;
+    map_info.is_image = true;
+  } else if (!map_info.zero_copy) {
+    /* Create space to assign pixel data to. Rows are pitch bytes apart so the copy into the BO lines up */
+    map_info.bytes = core->buff_data[0].pitches[0] * core->output_data[0].mode.vdisplay; /* 4 bytes = 32 bit, R = 8 bits, G = 8 bits, B = 8 bits, A = 8 bits */
+    map_info.pixel_data = mmap(NULL, map_info.bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, INDEX_IGNORE, core->buff_data[0].offsets[0]);
+    if (map_info.pixel_data == MAP_FAILED) { dlu_log_me(DLU_DANGER, "[x] %s", strerror(errno)); map_info.pixel_data = NULL; goto exit_func; }
+  }
+
+  if (map_info.zero_copy && !map_buffs(core)) goto exit_func;
+  if (map_info.is_image && !upload_image(core)) goto exit_func;
+
+  if (!map_info.is_image && map_info.threads != 1) {
+    map_info.pool = fill_pool_create(map_info.threads);
+    if (!map_info.pool) goto exit_func;
+    dlu_log_me(DLU_INFO, "Filling with %u threads", fill_pool_threads(map_info.pool));
   }
+
+  cpu_stat_now(&start);
+
+  if (!run_limit_start(&map_info.limit)) goto exit_func;
+  if (!kms_retry_init(&map_info.retry)) goto exit_func;
+
+  if (map_info.modeset_loop) {
+    uint64_t frames = modeset_loop(core);
+    cpu_stat_report(&start, "Modeset every frame");
+    if (map_info.limit.headless) summary(frames);
+    goto exit_func;
+  }
+
+  /* The only modeset, every frame after this one is a page flip */
+  draw_screen(core, map_info.front_buf);
+  if (!dlu_kms_modeset(core, map_info.front_buf)) goto exit_func;
+
+  draw_screen(core, map_info.front_buf^1);
+  present(core);
+
+  /* Each fd only runs its own handler, so libinput is never polled because a flip completed */
+  if (!ev_loop_init(&loop)) goto exit_func;
+  if (!ev_loop_add(&loop, core->device.kmsfd, "kms", kms_ready, &ev)) goto exit_free_events;
+  if (!ev_loop_add(&loop, map_info.retry.timerfd, "retry", retry_ready, core)) goto exit_free_events;
+  if (!map_info.limit.headless && !ev_loop_add(&loop, dlu_input_retrieve_fd(core), "input", input_ready, core)) goto exit_free_events;
+  if (map_info.limit.timerfd >= 0 && !ev_loop_add(&loop, map_info.limit.timerfd, "limit", limit_ready, NULL)) goto exit_free_events;
+
+  while (ev_loop_dispatch(&loop)) {
+    if (caught_signal == SIGUSR1) { caught_signal = 0; flip_rec_report(&map_info.flips); }
+    if (caught_signal) break;
+    if (run_limit_reached(&map_info.limit, map_info.flips.count)) break;
+  }
+
+exit_free_events:
+  cpu_stat_report(&start, "Page flip on vblank");
+  ev_loop_report(&loop, map_info.flips.count);
+  ev_loop_fini(&loop);
+  if (map_info.limit.headless) summary(map_info.flips.count);
+exit_func:
+  flip_rec_report(&map_info.flips);
+  fill_pool_destroy(map_info.pool);
+  unmap_buffs();
+  img_file_unmap(&map_info.img);
+  if (map_info.pixel_data) munmap(map_info.pixel_data, map_info.bytes);
+  kms_retry_fini(&map_info.retry);
+  run_limit_fini(&map_info.limit);
+}
+
+static void usage(const char *prog) {
+  dlu_log_me(DLU_DANGER, "Usage: %s [-z] [-d] [-c] [-m] [-t threads] [-f fit] [-s filter] [-D card] [-n frames] [-T seconds] [-H] [-J file] <path to image>", prog);
+  dlu_log_me(DLU_DANGER, "  -z  zero-copy, draw straight into the mapped scanout buffers");
+  dlu_log_me(DLU_DANGER, "  -d  dumb buffer backend, scan out of dumb buffers written with non-temporal stores (implies -z)");
+  dlu_log_me(DLU_DANGER, "  -c  keep composed frames in the raw frame cache ($XDG_CACHE_HOME/lucurious-examples, at most %llu MiB)", RAWCACHE_MAX_SIZE >> 20);
+  dlu_log_me(DLU_DANGER, "  -m  modeset every frame in a busy loop instead of flipping on vblank, to compare CPU use");
+  dlu_log_me(DLU_DANGER, "  -t  number of threads used to fill a frame, 0 = one per CPU, at most one per CPU (default 1)");
+  dlu_log_me(DLU_DANGER, "  -f  how images are placed: center, contain, cover or stretch (default contain)");
+  dlu_log_me(DLU_DANGER, "  -s  image scaling filter: nearest or bilinear (default bilinear)");
+  dlu_log_me(DLU_DANGER, "  -D  KMS node to drive (default %s)", RUN_LIMIT_CARD);
+  dlu_log_me(DLU_DANGER, "  -n  stop after this many frames");
+  dlu_log_me(DLU_DANGER, "  -T  stop after this many seconds");
+  dlu_log_me(DLU_DANGER, "  -H  headless, no logind session or libinput, JSON summary on stdout (e.g. vkms in CI)");
+  dlu_log_me(DLU_DANGER, "  -J  with -H, write the JSON summary to this file instead of stdout, where the log would get mixed in");
 }
 
 int main(int argc, char *argv[]) {
+  int opt = 0;
+
+  run_limit_init(&map_info.limit);
+  map_info.retry.timerfd = -1;
+  map_info.threads = 1;
+  map_info.fit = BLIT_FIT_CONTAIN;
+  map_info.filter = BLIT_FILTER_BILINEAR;
+  while ((opt = getopt(argc, argv, "zdcmHt:f:s:D:n:T:J:")) != -1) {
+    switch (opt) {
+      case 'z': map_info.zero_copy = true; break;
+      case 'd': map_info.dumb = map_info.zero_copy = true; break;
+      case 'c': map_info.use_cache = true; break;
+      case 'm': map_info.modeset_loop = true; break;
+      case 't':
+        if (!fill_pool_parse_threads(optarg, &map_info.threads)) { usage(argv[0]); return EXIT_FAILURE; }
+        break;
+      case 'f':
+        map_info.fit = blit_fit_from_name(optarg);
+        if (map_info.fit == BLIT_FIT_MAX) { usage(argv[0]); return EXIT_FAILURE; }
+        break;
+      case 's':
+        map_info.filter = blit_filter_from_name(optarg);
+        if (map_info.filter == BLIT_FILTER_MAX) { usage(argv[0]); return EXIT_FAILURE; }
+        break;
+      case 'D': map_info.limit.card = optarg; break;
+      case 'n':
+        map_info.limit.frames = strtoull(optarg, NULL, 10);
+        if (!map_info.limit.frames) { usage(argv[0]); return EXIT_FAILURE; }
+        break;
+      case 'T':
+        map_info.limit.seconds = strtod(optarg, NULL);
+        if (map_info.limit.seconds <= 0) { usage(argv[0]); return EXIT_FAILURE; }
+        break;
+      case 'H': map_info.limit.headless = true; break;
+      case 'J': map_info.limit.json_path = optarg; break;
+      default: usage(argv[0]); return EXIT_FAILURE;
+    }
+  }
 
-  if (argc > 2) {
-    dlu_log_me(DLU_DANGER, "Usage: %s <path to image>", argv[0]);
+  if (argc - optind > 1) {
+    usage(argv[0]);
     return EXIT_FAILURE;
   }
 
@@ -178,9 +420,10 @@ int main(int argc, char *argv[]) {
   * First creates a logind session. This allows for access to
   * privileged devices without being root.
   * Then find a suitable kms node = drm device = gpu
+  * Headless runs (vkms in CI) have no seat, the node is opened as is.
   */
-  check_err(!dlu_session_create(core), core)
-  check_err(!dlu_kms_node_create(core, "/dev/dri/card0"), core)
+  if (!map_info.limit.headless) check_err(!dlu_session_create(core), core)
+  check_err(!dlu_kms_node_create(core, map_info.limit.card), core)
 
   dlu_disp_device_info dinfo[1];
   check_err(!dlu_kms_q_output_chain(core, dinfo), core) 
@@ -189,17 +432,24 @@ int main(int argc, char *argv[]) {
   /* Saves the sate of the Plane -> CRTC -> Encoder -> Connector pair */
   check_err(!dlu_kms_enum_device(core, cur_odb, dinfo->conn_idx, dinfo->enc_idx, dinfo->crtc_idx,
                                  dinfo->plane_idx, dinfo->refresh, dinfo->conn_name), core);
+  snprintf(map_info.name, sizeof(map_info.name), "%s", dinfo->conn_name);
 
   /* Create libinput context, Establish connection to kernel input system */
-  check_err(!dlu_input_create(core), core);
+  if (!map_info.limit.headless) check_err(!dlu_input_create(core), core);
 
-  check_err(!dlu_fb_create(core, ma.dob_cnt, &(dlu_disp_fb_info) {
-    .type = DLU_DISPLAY_GBM_BO, .cur_odb = cur_odb, .depth = 24, .bpp = 32,
-    .bo_flags = GBM_BO_USE_SCANOUT|GBM_BO_USE_WRITE, .format = GBM_BO_FORMAT_XRGB8888, .flags = 0
-  }), core);
+  /* No GBM BOs at all with -d, the dumb buffers are what gets modeset and flipped */
+  if (map_info.dumb) {
+    check_err(!dumb_buf_fb_create(map_info.dumbs, core, cur_odb, 0, ma.dob_cnt), core);
+  } else {
+    check_err(!dlu_fb_create(core, ma.dob_cnt, &(dlu_disp_fb_info) {
+      .type = DLU_DISPLAY_GBM_BO, .cur_odb = cur_odb, .depth = 24, .bpp = 32,
+      .bo_flags = GBM_BO_USE_SCANOUT|GBM_BO_USE_WRITE|(map_info.zero_copy ? GBM_BO_USE_LINEAR : 0), .format = GBM_BO_FORMAT_XRGB8888, .flags = 0
+    }), core);
+  }
 
-  handle_screen(core, argv[1]);
+  handle_screen(core, (optind < argc) ? argv[optind] : NULL);
 
+  if (map_info.dumb) dumb_buf_fb_destroy(map_info.dumbs, core, 0, ma.dob_cnt);
   FREEME(core);
 
   return EXIT_SUCCESS;
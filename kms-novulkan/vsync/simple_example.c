@@ -32,94 +32,352 @@
 #include <errno.h>
 #include <stdbool.h>
 #include <unistd.h>
+#include <getopt.h>
+#include <signal.h>
 #include <sys/mman.h>
-#include <sys/epoll.h>
 
-/* For Libinput input event codes */
-#include <linux/input-event-codes.h>
+#include <drm_fourcc.h>
 
 #include "simple_example.h"
+#include "fill.h"
+#include "fillpool.h"
+#include "bomap.h"
+#include "blit.h"
+#include "imgload.h"
+#include "imgupload.h"
+#include "quit.h"
+#include "rawcache.h"
+#include "fliprec.h"
+#include "evloop.h"
+#include "deadline.h"
+#include "slideshow.h"
+#include "fbring.h"
+#include "kmsout.h"
+#include "runlimit.h"
+#include "kmsretry.h"
 
 #define UNUSED __attribute__((unused))
 
-static struct _map_info {
-  bool is_image;
+/* Everything kept per head. Each one flips on its own vblank with its own buffers */
+typedef struct _output {
+  dlu_disp_core *core;
+  uint32_t odb; /* Index into core->output_data */
+  uint32_t base; /* This output's first BO in core->buff_data, fb_ring indices are relative to it */
+  char name[32];
+  uint32_t width;
+  uint32_t height;
+  uint32_t pitch;
   size_t bytes;
   uint8_t *pixel_data;
-} map_info;
+  bo_map *maps; /* One persistent CPU mapping per scanout BO when zero_copy is set */
+  slideshow *show; /* Only when more than one image matched, decoded at this output's size */
+  slide *slide; /* On screen, copied into each BO as it comes up for drawing */
+  uint32_t slide_bos; /* Bit per BO that already holds the slide */
+  uint8_t r, g, b;
+  bool r_up, g_up, b_up, colored;
+  fb_ring ring; /* State of every scanout BO, map_info.depth of them */
+  flip_rec flips; /* Every flip completion, reported on exit */
+  deadline dl;
+} output;
 
-static dlu_otma_mems ma = { .drmc_cnt = 1, .dod_cnt = 1, .dob_cnt = 2 };
+static struct _map_info {
+  bool is_image;
+  bool zero_copy;
+  bool dumb; /* Scan out of dumb buffers filled with streaming stores instead of the GBM BOs */
+  dumb_buf *dumbs; /* The scanout buffers when dumb is set, indexed like core->buff_data */
+  uint32_t threads;
+  fill_pool *pool; /* Shared by every output, NULL when filling on the main thread only */
+  img_file img; /* Read-only mapping of the image file, decoded in upload_image() */
+  uint32_t img_width;
+  uint32_t img_height;
+  blit_fit fit;
+  blit_filter filter;
+  bool use_cache; /* Keep composed images in the raw frame cache */
+  char **paths; /* Everything the image argument matched */
+  uint32_t path_cnt;
+  double interval;
+  uint32_t ahead;
+  bool late; /* Draw each frame just before its vblank instead of right after the last flip */
+  uint32_t depth; /* Scanout buffers per output */
+  uint32_t max_outputs;
+  uint32_t output_cnt;
+  output outputs[KMS_OUTPUT_MAX];
+  run_limit limit; /* Card, frame and time limits, headless CI runs */
+  kms_retry retry; /* Resubmits flips the kernel turned down */
+} map_info;
 
-static inline void init_epoll_values(struct epoll_event *event) {
-  event->events = 0; event->data.ptr = NULL; event->data.fd = 0;
-  event->data.u32 = 0; event->data.u64 = 0;
-}
+/* Room for the most outputs and buffers there could be, init_buffs() takes what's actually used */
+static dlu_otma_mems ma = { .drmc_cnt = 1, .dod_cnt = KMS_OUTPUT_MAX, .dob_cnt = KMS_OUTPUT_MAX * FB_RING_MAX };
 
 static bool init_buffs(dlu_disp_core *core) {
   bool err;
 
-  err = dlu_otba(DLU_DEVICE_OUTPUT_DATA, core, INDEX_IGNORE, ma.dod_cnt);
+  err = dlu_otba(DLU_DEVICE_OUTPUT_DATA, core, INDEX_IGNORE, map_info.output_cnt);
   if (!err) return err;
 
-  err = dlu_otba(DLU_DEVICE_OUTPUT_BUFF_DATA, core, INDEX_IGNORE, ma.dob_cnt);
+  err = dlu_otba(DLU_DEVICE_OUTPUT_BUFF_DATA, core, INDEX_IGNORE, map_info.output_cnt * map_info.depth);
   if (!err) return err;
 
   return err;
 }
 
+/* Map every scanout BO once so draw_screen can render straight into the back buffer */
+static bool map_buffs(output *out) {
+  out->maps = calloc(map_info.depth, sizeof(bo_map));
+  if (!out->maps) { dlu_log_me(DLU_DANGER, "[x] calloc: %s", strerror(errno)); return false; }
+
+  for (uint32_t i = 0; i < map_info.depth; i++) {
+    dlu_disp_buff_data *bd = &out->core->buff_data[out->base + i];
+    if (map_info.dumb ? !bo_map_create_dumb(&out->maps[i], out->core->device.kmsfd, &map_info.dumbs[out->base + i])
+                      : !bo_map_create(&out->maps[i], bd->bo, out->width, out->height))
+      return false;
+  }
+
+  return true;
+}
+
+static void unmap_buffs(output *out) {
+  if (!out->maps) return;
+  for (uint32_t i = 0; i < map_info.depth; i++)
+    bo_map_destroy(&out->maps[i]);
+  free(out->maps); out->maps = NULL;
+}
+
+/**
+* Decodes the image into every one of out's BOs, see img_upload_run(). With -c later
+* outputs of this run with the same mode as an earlier one hit the cached frame.
+*/
+static bool upload_image(output *out) {
+  blit_surface dst = { NULL, out->width, out->height, out->pitch };
+  img_upload up = {
+    .img = &map_info.img, .img_width = map_info.img_width, .img_height = map_info.img_height,
+    .fit = map_info.fit, .filter = map_info.filter, .use_cache = map_info.use_cache,
+    .name = out->name, .count = map_info.depth, .buffs = out->core->buff_data + out->base,
+    .maps = (map_info.zero_copy) ? out->maps : NULL
+  };
+
+  bool ret = img_upload_run(&up, &dst);
+
+  /* Nothing will be written into the buffers again */
+  unmap_buffs(out);
+
+  return ret;
+}
+
+static bool start_slideshow(output *out) {
+  blit_surface dst = { NULL, out->width, out->height, out->pitch };
+
+  out->show = slideshow_create(map_info.paths, map_info.path_cnt, &dst, map_info.fit, map_info.filter,
+                               map_info.interval, map_info.ahead, map_info.use_cache);
+  if (!out->show) return false;
+
+  dlu_log_me(DLU_INFO, "Slideshow of %u images on %s, %.2fs each, decoding up to %u ahead",
+             map_info.path_cnt, out->name, map_info.interval, map_info.ahead);
+
+  /* The only time the decoder is waited on */
+  out->slide = slideshow_first(out->show);
+  return out->slide != NULL;
+}
+
+/* Runs in the flip handler, all it ever does is copy a slide the decode thread already finished */
+static void show_slide(output *out, uint32_t buf) {
+  slide *next = slideshow_poll(out->show);
+  if (next) { out->slide = next; out->slide_bos = 0; }
+
+  if (out->slide_bos & (1u << buf)) return;
+
+  if (map_info.zero_copy) {
+    if (!bo_map_begin(&out->maps[buf])) return;
+    bo_map_copy(&out->maps[buf], out->slide->pixels, out->pitch, out->pitch, out->height);
+    bo_map_end(&out->maps[buf]);
+  } else {
+    dlu_fb_gbm_bo_write(out->core->buff_data[out->base + buf].bo, out->slide->pixels, (size_t) out->pitch * out->height);
+  }
+
+  out->slide_bos |= 1u << buf;
+}
+
 static uint8_t next_color(bool *up, uint8_t cur, unsigned int mod) {
   uint8_t next;
-  
+
   next = cur + (*up ? 1 : -1) * (rand() % mod);
   if ((*up && next < cur) || (!*up && next > cur)) {
     *up = !*up;
     next = cur;
   }
-  
+
   return next;
 }
 
-static void draw_screen(dlu_disp_core *core, uint8_t front_buf) {
-  static uint8_t r, g, b;
-  static bool r_up = true, g_up = true, b_up = true, run_once = false;
+static void draw_screen(output *out, uint32_t idx) {
+  static bool run_once = false;
+
+  bo_map *map = NULL;
+
+  /* Every BO already holds the image (or the current slide), all that's left is to flip between them */
+  if (out->show) show_slide(out, idx);
+  if (map_info.is_image) return;
 
-  if (map_info.is_image) goto display;
+  /* Let the kernel know the CPU is about to write into the back buffer */
+  if (map_info.zero_copy) {
+    map = &out->maps[idx];
+    if (!bo_map_begin(map)) return;
+  }
 
   if (!run_once) {
     srand(time(NULL));
-    r = rand() % 0xff;
-    g = rand() % 0xff;
-    b = rand() % 0xff;
     run_once = true;
   }
 
-  r = next_color(&r_up, r, 20);
-  g = next_color(&g_up, g, 10);
-  b = next_color(&b_up, b, 5);
+  if (!out->colored) {
+    out->r = rand() % 0xff;
+    out->g = rand() % 0xff;
+    out->b = rand() % 0xff;
+    out->r_up = out->g_up = out->b_up = true;
+    out->colored = true;
+  }
+
+  out->r = next_color(&out->r_up, out->r, 20);
+  out->g = next_color(&out->g_up, out->g, 10);
+  out->b = next_color(&out->b_up, out->b, 5);
+
+  /* pitch = stride = width of a row in bytes, including any padding the driver added */
+  uint8_t *pixels = (map) ? map->pixels : out->pixel_data;
+  uint32_t pitch = (map) ? map->stride : out->pitch;
+
+  /* Returns once every band is written, so the buffer is complete before it's queued */
+  fill_pool_rect32(map_info.pool, pixels, pitch, out->width, out->height, (out->r << 16) | (out->g << 8) | out->b);
+
+  if (map) bo_map_end(map);
+  else dlu_fb_gbm_bo_write(out->core->buff_data[out->base + idx].bo, out->pixel_data, out->bytes);
+}
+
+/* Hands the oldest finished buffer to the kernel, unless a flip is still in flight */
+static void present(output *out) {
+  int32_t idx = fb_ring_flip(&out->ring);
+  if (idx == -1) return;
+
+  /* The output comes back as the flip event's user data */
+  if (dlu_kms_page_flip(out->core, out->base + idx, out)) return;
+
+  /* No event is coming for a flip that was turned down, the retry timer submits it again */
+  fb_ring_cancel(&out->ring, idx);
+  kms_retry_arm(&map_info.retry);
+}
+
+/* Draws into every free buffer, so the next frames are finished before their vblank comes around */
+static void render_ahead(output *out) {
+  int32_t idx = -1;
+
+  while ((idx = fb_ring_acquire(&out->ring)) != -1) {
+    draw_screen(out, idx);
+    fb_ring_queue(&out->ring, idx);
+  }
+
+  present(out);
+}
+
+static void modeset_page_flip_event(int UNUSED fd, unsigned int frame, unsigned int sec, unsigned int usec, void *data) {
+  output *out = (output *) data;
+
+  out->core->output_data[out->odb].pflip = false;
+  flip_rec_add(&out->flips, frame, sec, usec);
+  fb_ring_flipped(&out->ring, sec, usec);
+  if (map_info.late) deadline_flipped(&out->dl, frame, sec, usec);
+
+  /* A frame drawn ahead of time goes to the kernel before anything new gets drawn */
+  present(out);
+
+  /* Late rendering waits for the timer, so the frame is as fresh as possible when it hits the screen */
+  if (map_info.late) deadline_arm(&out->dl);
+  else render_ahead(out);
+}
+
+/* An output's deadline timer fired, draw one frame and flip it straight away */
+static bool timer_ready(ev_source *src) {
+  output *out = (output *) src->data;
+  double start = deadline_now();
+
+  deadline_fired(&out->dl);
+  src->syscalls++;
 
-  for (uint32_t j = 0; j <  core->output_data[0].mode.vdisplay; j++)
-    for (uint32_t k = 0; k < core->output_data[0].mode.hdisplay; k++) /* pitch = stride */
-      *(uint32_t *) &map_info.pixel_data[core->buff_data[0].pitches[0] * j + k * 4] = (r << 16) | (g << 8) | b;
+  int32_t idx = fb_ring_acquire(&out->ring);
+  if (idx == -1) return true;
 
-display:
-  dlu_fb_gbm_bo_write(core->buff_data[front_buf].bo, map_info.pixel_data, map_info.bytes);
+  draw_screen(out, idx);
+  fb_ring_queue(&out->ring, idx);
+  present(out);
 
-  if (!dlu_kms_page_flip(core, front_buf, core)) return;
+  deadline_fill_time(&out->dl, deadline_now() - start);
+  return true;
 }
 
-static void modeset_page_flip_event(int UNUSED fd, unsigned int UNUSED frame, unsigned int UNUSED sec, unsigned int UNUSED usec, void *data) {
-  static uint8_t front_buf = 0;
-  dlu_disp_core *core = (dlu_disp_core *) data;
- 
-  core->output_data[front_buf^1].pflip = false;
-  draw_screen(core, front_buf^1);
+/* A flip was turned down, every output with frames waiting and nothing in flight tries again */
+static bool retry_ready(ev_source *src) {
+  kms_retry_fired(&map_info.retry);
+  src->syscalls++;
+
+  for (uint32_t i = 0; i < map_info.output_cnt; i++)
+    present(&map_info.outputs[i]);
+
+  return true;
+}
+
+/* Every pending DRM event (flip completions of every output) in as few reads as possible */
+static bool kms_ready(ev_source *src) {
+  return ev_drain_drm(src, (drmEventContext *) src->data);
+}
+
+/* The time limit ran out, leave even if an output stopped flipping */
+static bool limit_ready(ev_source *src) {
+  src->syscalls++;
+  return false;
+}
 
-  front_buf ^= 1;
+/* Frame limits count what every output has shown, not the total */
+static uint64_t fewest_flips(void) {
+  uint64_t fewest = UINT64_MAX;
+  for (uint32_t i = 0; i < map_info.output_cnt; i++)
+    if (map_info.outputs[i].flips.count < fewest) fewest = map_info.outputs[i].flips.count;
+  return (map_info.output_cnt) ? fewest : 0;
+}
+
+/* Mode and layout of the output's buffers, plus the staging frame when there's no zero-copy */
+static bool setup_output(dlu_disp_core *core, output *out, uint32_t odb) {
+  out->core = core;
+  out->odb = odb;
+  out->base = odb * map_info.depth;
+  out->width = core->output_data[odb].mode.hdisplay;
+  out->height = core->output_data[odb].mode.vdisplay;
+  out->pitch = core->buff_data[out->base].pitches[0];
+  fb_ring_init(&out->ring, map_info.depth);
+
+  /* main() modesets every BO in turn, so the output's last one is being scanned out and mustn't be drawn into */
+  fb_ring_scanout(&out->ring, map_info.depth - 1);
+
+  if (!map_info.is_image && !map_info.zero_copy) {
+    /* Create space to assign pixel data to. Rows are pitch bytes apart so the copy into the BO lines up */
+    out->bytes = (size_t) out->pitch * out->height; /* 4 bytes = 32 bit, R = 8 bits, G = 8 bits, B = 8 bits, A = 8 bits */
+    out->pixel_data = mmap(NULL, out->bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, INDEX_IGNORE, core->buff_data[out->base].offsets[0]);
+    if (out->pixel_data == MAP_FAILED) { dlu_log_me(DLU_DANGER, "[x] %s", strerror(errno)); out->pixel_data = NULL; return false; }
+  }
+
+  if (map_info.zero_copy && !map_buffs(out)) return false;
+  if (map_info.late && !deadline_init(&out->dl, core->output_data[odb].mode.vrefresh)) return false;
+
+  return true;
+}
+
+static void report_output(output *out) {
+  dlu_log_me(DLU_INFO, "%s (%ux%u):", out->name, out->width, out->height);
+  flip_rec_report(&out->flips);
+  if (map_info.late) deadline_report(&out->dl);
+  fb_ring_report(&out->ring, &out->flips);
 }
 
 static void handle_screen(dlu_disp_core *core, const char *image) {
-  uint32_t event_fd = 0, ready_fds = 0, max_events = 2;
-  struct epoll_event *events = NULL;
+  uint64_t frames = 0;
+  ev_loop loop;
 
   /**
   * Set this to only the latest version you support. Version 2
@@ -130,111 +388,190 @@ static void handle_screen(dlu_disp_core *core, const char *image) {
   ev.version = 2;
   ev.page_flip_handler = modeset_page_flip_event;
 
+  /* Reported on the way out whatever happens, so every timerfd has to read as unopened */
+  for (uint32_t i = 0; i < map_info.output_cnt; i++)
+    map_info.outputs[i].dl.timerfd = -1;
+  map_info.retry.timerfd = -1;
+
+  catch_signals();
+
+  if (map_info.dumb) {
+    /* Dumb mappings are write-combined, streaming stores fill them without touching the cache */
+    fill_set_kernel(fill_stream_kernel());
+    dlu_log_me(DLU_INFO, "Scanning out of dumb buffers, filling with the %s kernel", fill_kernel_name(fill_get_kernel()));
+  }
+
   if (image) {
-    dlu_file_info picture = dlu_read_file(image);
-    if (!picture.bytes) goto exit_func;
-
-    int pw = 0, ph = 0, pchannels = 0, requested_channels = STBI_rgb_alpha;
-    map_info.pixel_data = stbi_load_from_memory((unsigned char *) picture.bytes, picture.byte_size, &pw, &ph, &pchannels, requested_channels);
-    if (!map_info.pixel_data) {
-      dlu_log_me(DLU_DANGER, "[x] %s", stbi_failure_reason());
-      free(picture.bytes);
-      goto exit_func;
-    }
+    /* A directory or glob matching more than one image turns into a slideshow */
+    map_info.paths = slideshow_list(image, &map_info.path_cnt);
+    if (!map_info.paths) goto exit_func;
 
-    map_info.is_image = true;
-    free(picture.bytes);
+    if (map_info.path_cnt == 1) {
+      /* Decoded straight from the page cache in upload_image(), the encoded bytes are never copied */
+      if (!img_file_map(&map_info.img, map_info.paths[0])) goto exit_func;
 
-    if (pw != core->output_data[0].mode.hdisplay) {
-      dlu_log_me(DLU_DANGER, "[x] For now the picture pixel width must be picture must be the \
-                           same amount of pixels the monitor will allow (%u)", core->output_data[0].mode.hdisplay);
-      goto exit_func;
+      /* Any size goes, upload_image() crops, letterboxes or scales it into the BOs */
+      if (!img_probe(&map_info.img, &map_info.img_width, &map_info.img_height)) goto exit_func;
     }
+    map_info.is_image = true;
+  }
 
-    /* Calculate image size in bytes */
-    map_info.bytes = core->output_data[0].mode.hdisplay * core->output_data[0].mode.vdisplay * (requested_channels <= 0 ? pchannels : requested_channels); 
-  } else {
-    /* Create space to assign pixel data to */
-    map_info.bytes = core->output_data[0].mode.hdisplay * core->output_data[0].mode.vdisplay * 4; /* 4 bytes = 32 bit, R = 8 bits, G = 8 bits, B = 8 bits, A = 8 bits */
-    map_info.pixel_data = mmap(NULL, map_info.bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, INDEX_IGNORE, core->buff_data[0].offsets[0]);
-    if (map_info.pixel_data == MAP_FAILED) { dlu_log_me(DLU_DANGER, "[x] %s", strerror(errno)); goto exit_func; }
+  for (uint32_t i = 0; i < map_info.output_cnt; i++) {
+    output *out = &map_info.outputs[i];
+    if (!setup_output(core, out, i)) goto exit_func;
+    if (map_info.path_cnt == 1 && !upload_image(out)) goto exit_func;
+    if (map_info.path_cnt > 1 && !start_slideshow(out)) goto exit_func;
   }
 
-  /* Draw into initial buffer and schedule initial page-flip */
-  draw_screen(core, 1);
+  /* Every output has its copy of the image by now */
+  img_file_unmap(&map_info.img);
 
-  if ((event_fd = epoll_create1(0)) == UINT32_MAX) {
-    dlu_log_me(DLU_DANGER, "[x] epoll_create1: %s", strerror(errno));
-    goto exit_func;
+  if (!map_info.is_image && map_info.threads != 1) {
+    map_info.pool = fill_pool_create(map_info.threads);
+    if (!map_info.pool) goto exit_func;
+    dlu_log_me(DLU_INFO, "Filling %u outputs with %u threads", map_info.output_cnt, fill_pool_threads(map_info.pool));
   }
 
-  events = alloca(max_events * sizeof(struct epoll_event));
+  if (!run_limit_start(&map_info.limit)) goto exit_func;
+  if (!kms_retry_init(&map_info.retry)) goto exit_func;
+
+  /* Draw into every buffer and schedule the initial page-flip of every output */
+  for (uint32_t i = 0; i < map_info.output_cnt; i++)
+    render_ahead(&map_info.outputs[i]);
 
   /**
-  * EPOLLIN: Associate a file descriptor for read() operations
-  * By default epoll is level triggered.
-  * Add kmsfd to epoll interest list 
+  * Each fd only runs its own handler, so libinput is never polled because a flip completed.
+  * Flips of every output arrive on the one kms fd, the event's user data says whose it is.
   */
-  struct epoll_event event;
-  init_epoll_values(&event);
-
-  event.events = EPOLLIN;
-  event.data.fd = core->device.kmsfd;
-  if (epoll_ctl(event_fd, EPOLL_CTL_ADD, event.data.fd, &event) == -1) {
-    dlu_log_me(DLU_DANGER, "[x] epoll_ctl: %s", strerror(errno));
-    goto exit_free_events;
-  } 
-
-  /* Add libinput FD to epoll interest list */
-  int input_fd = dlu_input_retrieve_fd(core);
-  init_epoll_values(&event);
-
-  event.events = EPOLLIN;
-  event.data.fd = input_fd; /* Not needed but adding anyways */
-  if (epoll_ctl(event_fd, EPOLL_CTL_ADD, event.data.fd, &event) == -1) {
-    dlu_log_me(DLU_DANGER, "[x] epoll_ctl: %s", strerror(errno));
-    goto exit_free_events;
-  }
-
-  uint32_t key_code = UINT32_MAX;
-  while(1) {
-    /* Fetch the list of FD's that are ready for I/O from interest list. The kernel checks for this */
-    ready_fds = epoll_wait(event_fd, events, max_events, -1);
-    if (ready_fds == UINT32_MAX) {
-      dlu_log_me(DLU_DANGER, "[x] epoll_wait: %s", strerror(errno));
-      goto exit_free_events;
-    }
-
-    for (uint32_t i = 0; i < ready_fds; i++) {
-      if (!(events[i].events & EPOLLIN)) continue;
-  
-      if (dlu_input_retrieve(core, &key_code)) {
-        switch(key_code) {
-          case KEY_ESC: goto exit_free_events; break;
-          case KEY_Q: goto exit_free_events; break;
-          default: break;
-        }
+  if (!ev_loop_init(&loop)) goto exit_func;
+  if (!ev_loop_add(&loop, core->device.kmsfd, "kms", kms_ready, &ev)) goto exit_free_events;
+  if (!ev_loop_add(&loop, map_info.retry.timerfd, "retry", retry_ready, NULL)) goto exit_free_events;
+  if (!map_info.limit.headless && !ev_loop_add(&loop, dlu_input_retrieve_fd(core), "input", input_ready, core)) goto exit_free_events;
+  if (map_info.limit.timerfd >= 0 && !ev_loop_add(&loop, map_info.limit.timerfd, "limit", limit_ready, NULL)) goto exit_free_events;
+  for (uint32_t i = 0; i < map_info.output_cnt && map_info.late; i++)
+    if (!ev_loop_add(&loop, map_info.outputs[i].dl.timerfd, "timer", timer_ready, &map_info.outputs[i])) goto exit_free_events;
+
+  while (ev_loop_dispatch(&loop)) {
+    if (caught_signal == SIGUSR1) {
+      caught_signal = 0;
+      for (uint32_t i = 0; i < map_info.output_cnt; i++) {
+        dlu_log_me(DLU_INFO, "%s:", map_info.outputs[i].name);
+        flip_rec_report(&map_info.outputs[i].flips);
       }
-
-      if (events[i].data.fd == (int) core->device.kmsfd)
-        if (dlu_kms_handle_event(events[i].data.fd, &ev))
-          goto exit_free_events;
     }
+    if (caught_signal) break;
+    if (run_limit_reached(&map_info.limit, fewest_flips())) break;
   }
 
 exit_free_events:
-  close(event_fd);
+  for (uint32_t i = 0; i < map_info.output_cnt; i++)
+    frames += map_info.outputs[i].flips.count;
+  ev_loop_report(&loop, frames);
+  ev_loop_fini(&loop);
+
+  if (map_info.limit.headless) {
+    run_limit_summary_begin(&map_info.limit, "vsync");
+    for (uint32_t i = 0; i < map_info.output_cnt; i++)
+      run_limit_summary_output(&map_info.limit, map_info.outputs[i].name, &map_info.outputs[i].flips);
+    run_limit_summary_end(&map_info.limit, frames);
+  }
 exit_func:
-  if (map_info.pixel_data) {
-    if (image) stbi_image_free(map_info.pixel_data);
-    else munmap(map_info.pixel_data, map_info.bytes);
+  for (uint32_t i = 0; i < map_info.output_cnt; i++) {
+    output *out = &map_info.outputs[i];
+    report_output(out);
+    if (map_info.late) deadline_fini(&out->dl);
+    slideshow_destroy(out->show);
+    unmap_buffs(out);
+    if (out->pixel_data) munmap(out->pixel_data, out->bytes);
   }
+  slideshow_list_free(map_info.paths, map_info.path_cnt);
+  fill_pool_destroy(map_info.pool);
+  img_file_unmap(&map_info.img);
+  kms_retry_fini(&map_info.retry);
+  run_limit_fini(&map_info.limit);
+}
+
+static void usage(const char *prog) {
+  dlu_log_me(DLU_DANGER, "Usage: %s [-z] [-d] [-c] [-l] [-b buffers] [-o outputs] [-t threads] [-f fit] [-s filter] [-i seconds] [-k count] [-D card] [-n frames] [-T seconds] [-H] [-J file] <image, directory or glob>", prog);
+  dlu_log_me(DLU_DANGER, "  -z  zero-copy, draw straight into the mapped scanout buffers");
+  dlu_log_me(DLU_DANGER, "  -d  dumb buffer backend, scan out of dumb buffers written with non-temporal stores (implies -z)");
+  dlu_log_me(DLU_DANGER, "  -c  keep composed frames in the raw frame cache ($XDG_CACHE_HOME/lucurious-examples, at most %llu MiB)", RAWCACHE_MAX_SIZE >> 20);
+  dlu_log_me(DLU_DANGER, "  -l  late rendering, start each frame just in time for its vblank");
+  dlu_log_me(DLU_DANGER, "  -b  number of scanout buffers per output, 2 = double, 3 = triple buffering (2-4, default 2)");
+  dlu_log_me(DLU_DANGER, "  -o  most outputs to drive at once (1-%u, default every connected one)", KMS_OUTPUT_MAX);
+  dlu_log_me(DLU_DANGER, "  -t  number of threads used to fill a frame, 0 = one per CPU, at most one per CPU (default 1)");
+  dlu_log_me(DLU_DANGER, "  -f  how images are placed: center, contain, cover or stretch (default contain)");
+  dlu_log_me(DLU_DANGER, "  -s  image scaling filter: nearest or bilinear (default bilinear)");
+  dlu_log_me(DLU_DANGER, "  -i  seconds each slide stays up when more than one image matched (default 5)");
+  dlu_log_me(DLU_DANGER, "  -k  slides decoded ahead of the one on screen (default 2)");
+  dlu_log_me(DLU_DANGER, "  -D  KMS node to drive (default %s)", RUN_LIMIT_CARD);
+  dlu_log_me(DLU_DANGER, "  -n  stop once every output showed this many frames");
+  dlu_log_me(DLU_DANGER, "  -T  stop after this many seconds");
+  dlu_log_me(DLU_DANGER, "  -H  headless, no logind session or libinput, JSON summary on stdout (e.g. vkms in CI)");
+  dlu_log_me(DLU_DANGER, "  -J  with -H, write the JSON summary to this file instead of stdout, where the log would get mixed in");
 }
 
 int main(int argc, char *argv[]) {
+  int opt = 0;
+
+  run_limit_init(&map_info.limit);
+  map_info.threads = 1;
+  map_info.interval = 5.0;
+  map_info.ahead = 2;
+  map_info.depth = 2;
+  map_info.max_outputs = KMS_OUTPUT_MAX;
+  map_info.fit = BLIT_FIT_CONTAIN;
+  map_info.filter = BLIT_FILTER_BILINEAR;
+  while ((opt = getopt(argc, argv, "zdclHb:o:t:f:s:i:k:D:n:T:J:")) != -1) {
+    switch (opt) {
+      case 'z': map_info.zero_copy = true; break;
+      case 'd': map_info.dumb = map_info.zero_copy = true; break;
+      case 'c': map_info.use_cache = true; break;
+      case 'l': map_info.late = true; break;
+      case 'b':
+        map_info.depth = strtoul(optarg, NULL, 10);
+        if (map_info.depth < FB_RING_MIN || map_info.depth > FB_RING_MAX) { usage(argv[0]); return EXIT_FAILURE; }
+        break;
+      case 'o':
+        map_info.max_outputs = strtoul(optarg, NULL, 10);
+        if (!map_info.max_outputs || map_info.max_outputs > KMS_OUTPUT_MAX) { usage(argv[0]); return EXIT_FAILURE; }
+        break;
+      case 't':
+        if (!fill_pool_parse_threads(optarg, &map_info.threads)) { usage(argv[0]); return EXIT_FAILURE; }
+        break;
+      case 'f':
+        map_info.fit = blit_fit_from_name(optarg);
+        if (map_info.fit == BLIT_FIT_MAX) { usage(argv[0]); return EXIT_FAILURE; }
+        break;
+      case 's':
+        map_info.filter = blit_filter_from_name(optarg);
+        if (map_info.filter == BLIT_FILTER_MAX) { usage(argv[0]); return EXIT_FAILURE; }
+        break;
+      case 'i':
+        map_info.interval = strtod(optarg, NULL);
+        if (map_info.interval <= 0) { usage(argv[0]); return EXIT_FAILURE; }
+        break;
+      case 'k':
+        map_info.ahead = strtoul(optarg, NULL, 10);
+        if (!map_info.ahead) { usage(argv[0]); return EXIT_FAILURE; }
+        break;
+      case 'D': map_info.limit.card = optarg; break;
+      case 'n':
+        map_info.limit.frames = strtoull(optarg, NULL, 10);
+        if (!map_info.limit.frames) { usage(argv[0]); return EXIT_FAILURE; }
+        break;
+      case 'T':
+        map_info.limit.seconds = strtod(optarg, NULL);
+        if (map_info.limit.seconds <= 0) { usage(argv[0]); return EXIT_FAILURE; }
+        break;
+      case 'H': map_info.limit.headless = true; break;
+      case 'J': map_info.limit.json_path = optarg; break;
+      default: usage(argv[0]); return EXIT_FAILURE;
+    }
+  }
 
-  if (argc > 2) {
-    dlu_log_me(DLU_DANGER, "Usage: %s <path to image>", argv[0]);
+  if (argc - optind > 1) {
+    usage(argv[0]);
     return EXIT_FAILURE;
   }
 
@@ -243,38 +580,65 @@ int main(int argc, char *argv[]) {
   dlu_disp_core *core = dlu_disp_init_core();
   check_err(!core, NULL);
 
-  check_err(!init_buffs(core), core);
-
   /**
   * RUN IN TTY:
   * First creates a logind session. This allows for access to
   * privileged devices without being root.
   * Then find a suitable kms node = drm device = gpu
+  * Headless runs (vkms in CI) have no seat, the node is opened as is.
   */
-  check_err(!dlu_session_create(core), core)
-  check_err(!dlu_kms_node_create(core, "/dev/dri/card0"), core)
+  if (!map_info.limit.headless) check_err(!dlu_session_create(core), core)
+  check_err(!dlu_kms_node_create(core, map_info.limit.card), core)
 
-  dlu_disp_device_info dinfo[1];
-  check_err(!dlu_kms_q_output_chain(core, dinfo), core) 
+  dlu_disp_device_info dinfo[KMS_OUTPUT_MAX];
+  memset(dinfo, 0, sizeof(dinfo));
+  check_err(!dlu_kms_q_output_chain(core, dinfo), core)
 
-  uint32_t cur_odb = 0;
-  /* Saves the sate of the Plane -> CRTC -> Encoder -> Connector pair */
-  check_err(!dlu_kms_enum_device(core, cur_odb, dinfo->conn_idx, dinfo->enc_idx, dinfo->crtc_idx,
-                                 dinfo->plane_idx, dinfo->refresh, dinfo->conn_name), core);
+  /* Every other connected connector gets a chain of its own, then buffers for all of them */
+  map_info.output_cnt = kms_output_chains(core->device.kmsfd, dinfo, map_info.max_outputs);
+  check_err(!init_buffs(core), core);
+
+  for (uint32_t cur_odb = 0; cur_odb < map_info.output_cnt; cur_odb++) {
+    /* Saves the sate of the Plane -> CRTC -> Encoder -> Connector pair */
+    check_err(!dlu_kms_enum_device(core, cur_odb, dinfo[cur_odb].conn_idx, dinfo[cur_odb].enc_idx, dinfo[cur_odb].crtc_idx,
+                                   dinfo[cur_odb].plane_idx, dinfo[cur_odb].refresh, dinfo[cur_odb].conn_name), core);
+
+    snprintf(map_info.outputs[cur_odb].name, sizeof(map_info.outputs[cur_odb].name), "%s", dinfo[cur_odb].conn_name);
+    dlu_log_me(DLU_INFO, "Output %u: %s, CRTC %u, plane %u, %u Hz", cur_odb, dinfo[cur_odb].conn_name,
+               dinfo[cur_odb].crtc_idx, dinfo[cur_odb].plane_idx, dinfo[cur_odb].refresh);
+  }
 
   /* Create libinput context, Establish connection to kernel input system */
-  check_err(!dlu_input_create(core), core);
+  if (!map_info.limit.headless) check_err(!dlu_input_create(core), core);
 
-  check_err(!dlu_fb_create(core, ma.dob_cnt, &(dlu_disp_fb_info) {
-    . type = DLU_DISPLAY_GBM_BO, .cur_odb = cur_odb, .depth = 24, .bpp = 32,
-    .bo_flags = GBM_BO_USE_SCANOUT|GBM_BO_USE_WRITE, .format = GBM_BO_FORMAT_XRGB8888, .flags = 0
-  }), core);
+  /* Each output's buffers follow the previous output's, depth of them apiece */
+  if (map_info.dumb) {
+    map_info.dumbs = calloc(map_info.output_cnt * map_info.depth, sizeof(dumb_buf));
+    check_err(!map_info.dumbs, core);
+  }
+
+  for (uint32_t cur_odb = 0; cur_odb < map_info.output_cnt; cur_odb++) {
+    uint32_t base = cur_odb * map_info.depth;
+
+    /* No GBM BOs at all, the dumb buffers are what gets modeset and flipped */
+    if (map_info.dumb) {
+      check_err(!dumb_buf_fb_create(map_info.dumbs + base, core, cur_odb, base, map_info.depth), core);
+      continue;
+    }
+
+    check_err(!dlu_fb_create(core, map_info.depth, &(dlu_disp_fb_info) {
+      . type = DLU_DISPLAY_GBM_BO, .cur_odb = cur_odb, .depth = 24, .bpp = 32,
+      .bo_flags = GBM_BO_USE_SCANOUT|GBM_BO_USE_WRITE|(map_info.zero_copy ? GBM_BO_USE_LINEAR : 0), .format = GBM_BO_FORMAT_XRGB8888, .flags = 0
+    }), core);
+  }
 
-  for (uint32_t i = 0; i < ma.dob_cnt; i++)
+  for (uint32_t i = 0; i < map_info.output_cnt * map_info.depth; i++)
     check_err(!dlu_kms_modeset(core, i), core);
 
-  handle_screen(core, argv[1]);
+  handle_screen(core, (optind < argc) ? argv[optind] : NULL);
 
+  if (map_info.dumbs) dumb_buf_fb_destroy(map_info.dumbs, core, 0, map_info.output_cnt * map_info.depth);
+  free(map_info.dumbs);
   FREEME(core);
 
   return EXIT_SUCCESS;
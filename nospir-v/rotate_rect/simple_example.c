@@ -23,12 +23,17 @@
 */
 
 #include <stdio.h>
+#include <getopt.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <unistd.h>
 #include <stdbool.h>
 
 #include "simple_example.h"
+#include "pipecache.h"
+#include "spvcache.h"
+#include "startup.h"
+#include "devpick.h"
 
 #define NUM_DESCRIPTOR_SETS 1
 #define MAX_FRAMES 2
@@ -75,14 +80,55 @@ static bool init_buffs(vkcomp *app) {
   return err;
 }
 
-int main(void) {
+/* Only touches wc, so it can run on a startup thread */
+static bool create_client(void *wc) {
+  return dlu_create_client(wc);
+}
+
+typedef struct _shader_job {
+  spv_shader frag, vert;
+} shader_job;
+
+/* The GLSL is compiled while the device comes up, nothing here needs one */
+static bool compile_shaders(void *arg) {
+  shader_job *job = arg;
+  job->frag = spv_cache_compile(VK_SHADER_STAGE_FRAGMENT_BIT, spin_square_frag_src, "frag.spv", "main");
+  job->vert = spv_cache_compile(VK_SHADER_STAGE_VERTEX_BIT, spin_square_vert_src, "vert.spv", "main");
+  return job->frag.bytes && job->vert.bytes;
+}
+
+static void usage(const char *prog) {
+  dlu_log_me(DLU_DANGER, "Usage: %s [-g device]", prog);
+  dlu_log_me(DLU_DANGER, "  -g  vulkan device to use, index or part of its name (default $LUCUR_DEVICE, else the best scoring one)");
+}
+
+int main(int argc, char *argv[]) {
   VkResult err;
+  int opt = 0;
+
+  startup_begin();
+
+  const char *device = getenv("LUCUR_DEVICE");
+  while ((opt = getopt(argc, argv, "g:")) != -1) {
+    switch (opt) {
+      case 'g': device = optarg; break;
+      default: usage(argv[0]); return EXIT_FAILURE;
+    }
+  }
 
   if (!dlu_otma(DLU_LARGE_BLOCK_PRIV, ma)) return EXIT_FAILURE;
 
   wclient *wc = dlu_init_wc();
   check_err(!wc, NULL, NULL, NULL)
 
+  /* The Wayland roundtrips overlap instance creation, check_err() joins them before freeing wc */
+  startup_task client_task;
+  startup_spawn(&client_task, "wayland client", create_client, wc);
+
+  shader_job shaders;
+  startup_task shader_task;
+  startup_spawn(&shader_task, "shader compile", compile_shaders, &shaders);
+
   vkcomp *app = dlu_init_vk();
   check_err(!app, NULL, wc, NULL)
 
@@ -92,17 +138,17 @@ int main(void) {
   err = dlu_create_instance(app, "Rotate Rect Example", "No Engine", 0, NULL, ARR_LEN(instance_extensions), instance_extensions);
   check_err(err, app, wc, NULL)
 
-  check_err(!dlu_create_client(wc), app, wc, NULL)
+  check_err(!startup_join(&client_task), app, wc, NULL)
 
   /* initialize vulkan app surface */
   err = dlu_create_vkwayland_surfaceKHR(app, wc->display, wc->surface);
   check_err(err, app, wc, NULL)
 
-  /* This will get the physical device, it's properties, and features */
+  /* Picks the best ranked physical device (or the requested one), it's properties, and features */
   VkPhysicalDeviceProperties device_props;
   VkPhysicalDeviceFeatures device_feats;
   uint32_t cur_pd = 0, cur_ld = 0;
-  err = dlu_create_physical_device(app, cur_pd, VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU, &device_props, &device_feats);
+  err = dev_pick_physical_device(app, cur_pd, device, ARR_LEN(device_extensions), device_extensions, &device_props, &device_feats);
   check_err(err, app, wc, NULL)
 
   err = dlu_create_queue_families(app, cur_pd, VK_QUEUE_GRAPHICS_BIT);
@@ -209,27 +255,28 @@ int main(void) {
   err = dlu_create_framebuffers(app, cur_scd, cur_gpd, 1, vkimg_attach, extent2D.width, extent2D.height, 1);
   check_err(err, app, wc, NULL)
 
-  err = dlu_create_pipeline_cache(app, cur_ld, 0, NULL);
+  /* Pipelines built by an earlier run come out of the cache, if it was written for this device and driver */
+  pipe_cache pcache;
+  pipe_cache_load(&pcache, "nospir-v-rotate_rect", &device_props);
+
+  err = dlu_create_pipeline_cache(app, cur_ld, pcache.size, pcache.data);
   check_err(err, app, wc, NULL)
 
   dlu_log_me(DLU_INFO, "Start of shader creation");
-  dlu_log_me(DLU_WARNING, "Compiling the fragment shader code to spirv bytes");
-  dlu_shader_info shi_frag = dlu_compile_to_spirv(VK_SHADER_STAGE_FRAGMENT_BIT, spin_square_frag_src, "frag.spv", "main");
-  check_err(!shi_frag.bytes, app, wc, NULL)
-
-  dlu_log_me(DLU_WARNING, "Compiling the vertex shader code into spirv bytes");
-  dlu_shader_info shi_vert = dlu_compile_to_spirv(VK_SHADER_STAGE_VERTEX_BIT, spin_square_vert_src, "vert.spv", "main");
-  check_err(!shi_vert.bytes, app, wc, NULL)
+  /* First thing that needs the SPIR-V */
+  check_err(!startup_join(&shader_task), app, wc, NULL)
+  spv_shader *shi_frag = &shaders.frag, *shi_vert = &shaders.vert;
   dlu_log_me(DLU_SUCCESS, "vert.spv and frag.spv officially created");
 
-  VkShaderModule frag_shader_module = dlu_create_shader_module(app, cur_ld, shi_frag.bytes, shi_frag.byte_size);
+  VkShaderModule frag_shader_module = dlu_create_shader_module(app, cur_ld, shi_frag->bytes, shi_frag->byte_size);
   check_err(!frag_shader_module, app, wc, NULL)
 
-  VkShaderModule vert_shader_module = dlu_create_shader_module(app, cur_ld, shi_vert.bytes, shi_vert.byte_size);
+  VkShaderModule vert_shader_module = dlu_create_shader_module(app, cur_ld, shi_vert->bytes, shi_vert->byte_size);
   check_err(!vert_shader_module, app, wc, frag_shader_module)
 
-  dlu_freeup_spriv_bytes(DLU_LIB_SHADERC_SPRIV, shi_vert.result);
-  dlu_freeup_spriv_bytes(DLU_LIB_SHADERC_SPRIV, shi_frag.result);
+  spv_cache_release(shi_vert);
+  spv_cache_release(shi_frag);
+  spv_cache_report();
   dlu_log_me(DLU_INFO, "End of shader creation");
 
   VkPipelineShaderStageCreateInfo vert_shader_stage_info = dlu_set_shader_stage_info(
@@ -273,11 +320,13 @@ int main(void) {
   err = dlu_otba(DLU_GP_DATA_MEMS, app, cur_gpd, ma.gp_cnt);
   check_err(!err, app, wc, NULL)
 
+  pipe_cache_begin(&pcache, app->ld_data[cur_ld].device, app->pipeline_cache);
   err = dlu_create_graphics_pipelines(app, cur_gpd, ARR_LEN(shader_stages), shader_stages,
     &vertex_input_info, &input_assembly, VK_NULL_HANDLE, &view_port_info,
     &rasterizer, &multisampling, VK_NULL_HANDLE, &color_blending,
     VK_NULL_HANDLE, 0, VK_NULL_HANDLE, UINT32_MAX
   );
+  pipe_cache_end(&pcache, app->ld_data[cur_ld].device, app->pipeline_cache);
   check_err(err, NULL, NULL, vert_shader_module)
   check_err(err, app, wc, frag_shader_module)
 
@@ -422,10 +471,15 @@ int main(void) {
 
     err = dlu_queue_present_queue(app, cur_ld, 1, &render_sems[cur_frame], 1, &app->sc_data[cur_scd].swap_chain, &img_index, NULL);
     check_err(err, app, wc, NULL)
+    startup_first_frame();
 
     cur_frame = (cur_frame + 1) % MAX_FRAMES;
   }
 
+  /* Written only if this run added to it */
+  pipe_cache_save(&pcache, app->ld_data[cur_ld].device, app->pipeline_cache);
+  pipe_cache_fini(&pcache);
+
   FREEME(app, wc)
 
   return EXIT_SUCCESS;
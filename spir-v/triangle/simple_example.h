@@ -47,7 +47,7 @@ typedef struct _vertex_2D {
 #define check_err(err,app,wc,shader) \
   do { \
     if (!shader && err) dlu_vk_destroy(DLU_DESTROY_VK_SHADER, app, 0, shader); \
-    if (err) { FREEME(app, wc) exit(-1); } \
+    if (err) { startup_join_all(); FREEME(app, wc) exit(-1); } \
   } while(0);
 
 const char *device_extensions[] = {
@@ -0,0 +1,160 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/* Only dlu_log_me(), the kms examples build this too and have no vulkan headers */
+#include <dluc/lucurious.h>
+
+#include "cachefile.h"
+
+#define CACHE_SUBDIR "lucurious-examples"
+
+bool cache_dir_path(char *dir, size_t size) {
+  const char *xdg = getenv("XDG_CACHE_HOME"), *home = getenv("HOME");
+
+  if (xdg && *xdg) snprintf(dir, size, "%s/%s", xdg, CACHE_SUBDIR);
+  else if (home && *home) snprintf(dir, size, "%s/.cache/%s", home, CACHE_SUBDIR);
+  else return false;
+
+  /* mkdir -p, ~/.cache may not exist on a fresh account */
+  for (char *slash = strchr(dir + 1, '/'); ; slash = strchr(slash + 1, '/')) {
+    if (slash) *slash = '\0';
+    if (mkdir(dir, 0700) == -1 && errno != EEXIST) {
+      dlu_log_me(DLU_WARNING, "[x] mkdir: %s: %s", dir, strerror(errno));
+      return false;
+    }
+    if (!slash) break;
+    *slash = '/';
+  }
+
+  return true;
+}
+
+char *cache_file_path(const char *name) {
+  char dir[4096];
+  char *path = NULL;
+
+  if (!cache_dir_path(dir, sizeof(dir))) return NULL;
+  if (asprintf(&path, "%s/%s", dir, name) == -1) return NULL;
+  return path;
+}
+
+void *cache_file_read(const char *path, size_t *size) {
+  struct stat st;
+  void *data = NULL;
+  size_t done = 0;
+
+  *size = 0;
+
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd == -1) return NULL; /* A miss, not worth a warning */
+
+  if (fstat(fd, &st) == -1 || st.st_size <= 0) goto exit_read;
+
+  data = malloc(st.st_size);
+  if (!data) { dlu_log_me(DLU_WARNING, "[x] malloc: %s", strerror(errno)); goto exit_read; }
+
+  while (done < (size_t) st.st_size) {
+    ssize_t got = read(fd, (char *) data + done, st.st_size - done);
+    if (got == -1 && errno == EINTR) continue;
+    if (got <= 0) {
+      dlu_log_me(DLU_WARNING, "[x] read: %s: %s", path, (got) ? strerror(errno) : "short read");
+      free(data); data = NULL;
+      goto exit_read;
+    }
+    done += got;
+  }
+
+  *size = done;
+
+exit_read:
+  close(fd);
+  return data;
+}
+
+void cache_dir_sync(const char *path) {
+  char *dir = strdup(path);
+  if (!dir) return;
+
+  char *slash = strrchr(dir, '/');
+  if (slash) *slash = '\0';
+
+  int fd = open((slash) ? dir : ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd == -1 || fsync(fd) == -1)
+    dlu_log_me(DLU_WARNING, "[x] fsync: %s: %s", (slash) ? dir : ".", strerror(errno));
+
+  if (fd != -1) close(fd);
+  free(dir);
+}
+
+bool cache_file_write(const char *path, const void *data, size_t size) {
+  char *tmp_path = NULL;
+  size_t done = 0;
+  bool ret = false;
+  int fd = -1;
+
+  if (asprintf(&tmp_path, "%s.XXXXXX", path) == -1) return false;
+
+  fd = mkostemp(tmp_path, O_CLOEXEC);
+  if (fd == -1) {
+    dlu_log_me(DLU_WARNING, "[x] mkostemp: %s: %s", tmp_path, strerror(errno));
+    free(tmp_path);
+    return false;
+  }
+
+  while (done < size) {
+    ssize_t put = write(fd, (const char *) data + done, size - done);
+    if (put == -1 && errno == EINTR) continue;
+    if (put == -1) { dlu_log_me(DLU_WARNING, "[x] write: %s: %s", tmp_path, strerror(errno)); goto exit_write; }
+    done += put;
+  }
+
+  /* Contents first, else a crash after the rename can leave the name pointing at an empty file */
+  if (fsync(fd) == -1) {
+    dlu_log_me(DLU_WARNING, "[x] fsync: %s: %s", tmp_path, strerror(errno));
+    goto exit_write;
+  }
+
+  if (rename(tmp_path, path) == -1) {
+    dlu_log_me(DLU_WARNING, "[x] rename: %s: %s", path, strerror(errno));
+    goto exit_write;
+  }
+
+  ret = true;
+  cache_dir_sync(path);
+
+exit_write:
+  close(fd);
+  if (!ret) unlink(tmp_path);
+  free(tmp_path);
+  return ret;
+}
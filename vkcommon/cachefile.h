@@ -0,0 +1,53 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#ifndef CACHEFILE_H
+#define CACHEFILE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+* Small blobs the examples keep between runs (pipeline caches, compiled SPIR-V),
+* all under $XDG_CACHE_HOME/lucurious-examples. The kms examples' raw frame cache
+* lives there too and shares the directory helpers. Writes go to a temp file that is
+* fsynced and renamed over the entry, then the directory is fsynced. A reader
+* never sees half an entry, and a crash leaves either the old one or the new one.
+*/
+
+/* The cache directory, created on the way. False without a home */
+bool cache_dir_path(char *dir, size_t size);
+
+/* Full path of name in the cache directory, created on the way. NULL without a home */
+char *cache_file_path(const char *name);
+
+/* fsyncs the directory holding path, so a rename into it survives a crash. Failing only warns */
+void cache_dir_sync(const char *path);
+
+/* Whole entry in a malloc'd buffer, NULL if it doesn't exist or can't be read */
+void *cache_file_read(const char *path, size_t *size);
+
+bool cache_file_write(const char *path, const void *data, size_t size);
+
+#endif
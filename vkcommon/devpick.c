@@ -0,0 +1,211 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "devpick.h"
+
+#define MAX_DEVICES 16
+#define MAX_QUEUE_FAMILIES 16
+#define UNUSABLE -1
+
+static const char *type_name(VkPhysicalDeviceType type) {
+  switch (type) {
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: return "discrete";
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: return "integrated";
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: return "virtual";
+    case VK_PHYSICAL_DEVICE_TYPE_CPU: return "cpu";
+    default: return "other";
+  }
+}
+
+/* Compared one field after the other, a later field only breaks ties of the ones before it */
+typedef struct _dev_rank {
+  long type; /* A software rasterizer never beats a GPU however much RAM it reports */
+  uint64_t mib;
+  long queues; /* UNUSABLE when the device can't be used at all */
+} dev_rank;
+
+static long type_rank(VkPhysicalDeviceType type) {
+  switch (type) {
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: return 4;
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: return 3;
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: return 2;
+    case VK_PHYSICAL_DEVICE_TYPE_CPU: return 1;
+    default: return 0;
+  }
+}
+
+/* > 0 when a ranks above b */
+static int rank_cmp(const dev_rank *a, const dev_rank *b) {
+  if (a->type != b->type) return (a->type > b->type) ? 1 : -1;
+  if (a->mib != b->mib) return (a->mib > b->mib) ? 1 : -1;
+  if (a->queues != b->queues) return (a->queues > b->queues) ? 1 : -1;
+  return 0;
+}
+
+static bool has_extensions(VkPhysicalDevice dev, uint32_t ext_cnt, const char *const *exts) {
+  uint32_t count = 0;
+  VkExtensionProperties *avail = NULL;
+  bool ret = false;
+
+  if (vkEnumerateDeviceExtensionProperties(dev, NULL, &count, NULL) != VK_SUCCESS) return false;
+
+  avail = calloc(count ? count : 1, sizeof(VkExtensionProperties));
+  if (!avail) return false;
+  if (vkEnumerateDeviceExtensionProperties(dev, NULL, &count, avail) != VK_SUCCESS) goto exit_ext;
+
+  for (uint32_t e = 0; e < ext_cnt; e++) {
+    uint32_t i = 0;
+    for (; i < count; i++)
+      if (!strcmp(exts[e], avail[i].extensionName)) break;
+    if (i == count) goto exit_ext;
+  }
+
+  ret = true;
+
+exit_ext:
+  free(avail);
+  return ret;
+}
+
+/* Queue layout: drawing and presenting from one family, plus async compute/transfer families */
+static long queue_score(VkPhysicalDevice dev, VkSurfaceKHR surface) {
+  VkQueueFamilyProperties fams[MAX_QUEUE_FAMILIES];
+  uint32_t count = MAX_QUEUE_FAMILIES;
+  bool gfx = false, present = false, both = false, compute = false, transfer = false;
+
+  vkGetPhysicalDeviceQueueFamilyProperties(dev, &count, fams);
+
+  for (uint32_t i = 0; i < count; i++) {
+    VkBool32 can_present = VK_FALSE;
+    VkQueueFlags flags = fams[i].queueFlags;
+
+    if (vkGetPhysicalDeviceSurfaceSupportKHR(dev, i, surface, &can_present) != VK_SUCCESS) can_present = VK_FALSE;
+
+    gfx |= flags & VK_QUEUE_GRAPHICS_BIT;
+    present |= can_present;
+    both |= (flags & VK_QUEUE_GRAPHICS_BIT) && can_present;
+    if (!(flags & VK_QUEUE_GRAPHICS_BIT)) {
+      compute |= flags & VK_QUEUE_COMPUTE_BIT;
+      transfer |= (flags & VK_QUEUE_TRANSFER_BIT) && !(flags & VK_QUEUE_COMPUTE_BIT);
+    }
+  }
+
+  if (!gfx || !present) return UNUSABLE;
+  return ((both) ? 2 : 0) + ((compute) ? 1 : 0) + ((transfer) ? 1 : 0);
+}
+
+/* Largest device local heap, in MiB */
+static uint64_t local_mib(VkPhysicalDevice dev) {
+  VkPhysicalDeviceMemoryProperties mem;
+  VkDeviceSize best = 0;
+
+  vkGetPhysicalDeviceMemoryProperties(dev, &mem);
+  for (uint32_t i = 0; i < mem.memoryHeapCount; i++)
+    if (mem.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT && mem.memoryHeaps[i].size > best)
+      best = mem.memoryHeaps[i].size;
+
+  return best >> 20;
+}
+
+static bool matches(const char *override, uint32_t index, const char *name) {
+  char *end = NULL;
+  unsigned long idx = strtoul(override, &end, 10);
+
+  if (end != override && !*end) return idx == index;
+  return strcasestr(name, override) != NULL;
+}
+
+VkResult dev_pick_physical_device(vkcomp *app, uint32_t cur_pd, const char *override,
+                                  uint32_t ext_cnt, const char *const *exts,
+                                  VkPhysicalDeviceProperties *props, VkPhysicalDeviceFeatures *feats) {
+  VkPhysicalDevice devs[MAX_DEVICES];
+  VkPhysicalDeviceProperties dprops[MAX_DEVICES];
+  dev_rank ranks[MAX_DEVICES];
+  uint32_t count = MAX_DEVICES;
+  int best = -1, wanted = -1;
+  VkResult res;
+
+  if (override && !*override) override = NULL;
+
+  res = vkEnumeratePhysicalDevices(app->instance, &count, devs);
+  if (res != VK_SUCCESS && res != VK_INCOMPLETE) {
+    dlu_log_me(DLU_DANGER, "[x] vkEnumeratePhysicalDevices failed, ERROR CODE: %d", res);
+    return res;
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    dev_rank *rank = &ranks[i];
+
+    vkGetPhysicalDeviceProperties(devs[i], &dprops[i]);
+    rank->type = type_rank(dprops[i].deviceType);
+    rank->mib = local_mib(devs[i]);
+    rank->queues = (has_extensions(devs[i], ext_cnt, exts)) ? queue_score(devs[i], app->surface) : UNUSABLE;
+
+    dlu_log_me(DLU_INFO, "Device %u: %s (%s), %lu MiB device local, queue layout %ld%s", i, dprops[i].deviceName,
+               type_name(dprops[i].deviceType), (unsigned long) rank->mib, rank->queues,
+               (rank->queues == UNUSABLE) ? " (unusable)" : "");
+
+    if (override && wanted == -1 && matches(override, i, dprops[i].deviceName)) {
+      if (rank->queues == UNUSABLE) dlu_log_me(DLU_WARNING, "Device: %s can't draw to this surface, ignoring \"%s\"", dprops[i].deviceName, override);
+      else wanted = i;
+    }
+
+    if (rank->queues != UNUSABLE && (best == -1 || rank_cmp(rank, &ranks[best]) > 0)) best = i;
+  }
+
+  if (override && wanted == -1) dlu_log_me(DLU_WARNING, "Device: nothing usable matches \"%s\", picking by rank", override);
+  if (wanted != -1) best = wanted;
+
+  if (best == -1) {
+    dlu_log_me(DLU_DANGER, "[x] No device can draw and present with the required extensions");
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
+  /**
+  * lucurious can only select by type and takes the first device of it. Its
+  * dlu_create_physical_device() writes nothing in pd_data but phys_dev, the
+  * queue family indices and everything else come later from calls that read
+  * phys_dev back (dlu_create_queue_families(), dlu_create_logical_device()).
+  * So phys_dev is the one field swapped here, props and feats are queried again,
+  * and this has to run before any of those calls.
+  */
+  res = dlu_create_physical_device(app, cur_pd, dprops[best].deviceType, props, feats);
+  if (res) return res;
+
+  if (app->pd_data[cur_pd].phys_dev != devs[best]) {
+    app->pd_data[cur_pd].phys_dev = devs[best];
+    vkGetPhysicalDeviceProperties(devs[best], props);
+    vkGetPhysicalDeviceFeatures(devs[best], feats);
+  }
+
+  dlu_log_me(DLU_SUCCESS, "Device: using %d, %s (%s)%s", best, props->deviceName,
+             type_name(props->deviceType), (wanted != -1) ? ", as requested" : "");
+  return VK_SUCCESS;
+}
@@ -0,0 +1,49 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#ifndef DEVPICK_H
+#define DEVPICK_H
+
+#include <stdint.h>
+
+#define LUCUR_VKCOMP_API
+#include <dluc/lucurious.h>
+
+/**
+* Stands in for dlu_create_physical_device() with a fixed device type. Every
+* device the instance sees is ranked: one that lacks a required extension or a
+* queue family that can draw and present to app->surface is out, the rest are
+* ordered by type (discrete > integrated > virtual > CPU), ties by device local
+* memory, remaining ties by queue layout. The table and the pick are logged.
+*
+* Only pd_data[cur_pd].phys_dev is set, call it before dlu_create_queue_families().
+*
+* override (LUCUR_DEVICE or -g) is an enumeration index or part of a device
+* name, case insensitive. It wins as long as the device is usable at all.
+*/
+VkResult dev_pick_physical_device(vkcomp *app, uint32_t cur_pd, const char *override,
+                                  uint32_t ext_cnt, const char *const *exts,
+                                  VkPhysicalDeviceProperties *props, VkPhysicalDeviceFeatures *feats);
+
+#endif
@@ -0,0 +1,147 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#define LUCUR_VKCOMP_API
+#include <dluc/lucurious.h>
+
+#include "cachefile.h"
+#include "pipecache.h"
+
+/* VkPipelineCacheHeaderVersionOne, spelled out since older headers don't have the struct */
+typedef struct _cache_header {
+  uint32_t size;
+  uint32_t version;
+  uint32_t vendor_id;
+  uint32_t device_id;
+  uint8_t uuid[VK_UUID_SIZE];
+} cache_header;
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static const char *check_header(const void *data, size_t size, const VkPhysicalDeviceProperties *props) {
+  cache_header hdr;
+
+  if (size < sizeof(cache_header)) return "truncated";
+  memcpy(&hdr, data, sizeof(cache_header));
+
+  if (hdr.size < sizeof(cache_header) || hdr.size > size) return "bad header size";
+  if (hdr.version != VK_PIPELINE_CACHE_HEADER_VERSION_ONE) return "unknown header version";
+  if (hdr.vendor_id != props->vendorID || hdr.device_id != props->deviceID) return "written for another device";
+  if (memcmp(hdr.uuid, props->pipelineCacheUUID, VK_UUID_SIZE)) return "written by another driver version";
+
+  return NULL;
+}
+
+void pipe_cache_load(pipe_cache *pc, const char *name, const VkPhysicalDeviceProperties *props) {
+  char file[256], uuid[VK_UUID_SIZE * 2 + 1];
+
+  memset(pc, 0, sizeof(pipe_cache));
+
+  /* One entry per device and driver build, two installed drivers don't keep overwriting each other */
+  for (uint32_t i = 0; i < VK_UUID_SIZE; i++)
+    snprintf(uuid + i * 2, 3, "%02x", props->pipelineCacheUUID[i]);
+  snprintf(file, sizeof(file), "%s-%04x-%04x-%s.vkpipecache", name, props->vendorID, props->deviceID, uuid);
+  pc->path = cache_file_path(file);
+  if (!pc->path) return;
+
+  pc->data = cache_file_read(pc->path, &pc->size);
+  if (!pc->data) {
+    dlu_log_me(DLU_INFO, "Pipeline cache: no entry at %s, starting empty", pc->path);
+    return;
+  }
+
+  const char *reason = check_header(pc->data, pc->size, props);
+  if (reason) {
+    dlu_log_me(DLU_WARNING, "Pipeline cache: %s is %s, starting empty", pc->path, reason);
+    free(pc->data); pc->data = NULL; pc->size = 0;
+    return;
+  }
+
+  dlu_log_me(DLU_INFO, "Pipeline cache: loaded %zu bytes from %s", pc->size, pc->path);
+}
+
+static size_t cache_size(VkDevice device, VkPipelineCache cache) {
+  size_t size = 0;
+  if (vkGetPipelineCacheData(device, cache, &size, NULL) != VK_SUCCESS) return 0;
+  return size;
+}
+
+void pipe_cache_begin(pipe_cache *pc, VkDevice device, VkPipelineCache cache) {
+  pc->before = cache_size(device, cache);
+  pc->start = now();
+}
+
+void pipe_cache_end(pipe_cache *pc, VkDevice device, VkPipelineCache cache) {
+  double ms = (now() - pc->start) * 1e3;
+  size_t after = cache_size(device, cache);
+
+  if (after > pc->before)
+    dlu_log_me(DLU_INFO, "Pipeline cache: miss, compiled in %.2f ms, cache grew %zu -> %zu bytes", ms, pc->before, after);
+  else
+    dlu_log_me(DLU_INFO, "Pipeline cache: hit, created in %.2f ms", ms);
+}
+
+bool pipe_cache_save(pipe_cache *pc, VkDevice device, VkPipelineCache cache) {
+  size_t size = 0;
+  void *data = NULL;
+  bool ret = false;
+
+  if (!pc->path || !cache) return false;
+
+  if (vkGetPipelineCacheData(device, cache, &size, NULL) != VK_SUCCESS || !size) return false;
+
+  data = malloc(size);
+  if (!data) return false;
+
+  /* VK_INCOMPLETE would mean the cache grew in between, nothing else uses it */
+  if (vkGetPipelineCacheData(device, cache, &size, data) != VK_SUCCESS) goto exit_save;
+
+  if (size == pc->size && !memcmp(data, pc->data, size)) {
+    ret = true;
+    goto exit_save;
+  }
+
+  ret = cache_file_write(pc->path, data, size);
+  if (ret) dlu_log_me(DLU_INFO, "Pipeline cache: wrote %zu bytes to %s", size, pc->path);
+
+exit_save:
+  free(data);
+  return ret;
+}
+
+void pipe_cache_fini(pipe_cache *pc) {
+  free(pc->path);
+  free(pc->data);
+  memset(pc, 0, sizeof(pipe_cache));
+}
@@ -0,0 +1,64 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#ifndef PIPECACHE_H
+#define PIPECACHE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <vulkan/vulkan.h>
+
+/**
+* Keeps the VkPipelineCache between runs, so a second launch gets its pipelines
+* out of the cache instead of compiling them again. The blob on disk is checked
+* against the device before it's handed to the driver: header version, vendor
+* and device ids and pipelineCacheUUID all have to match, anything else starts
+* from an empty cache.
+*
+* Whether pipeline creation was a hit is told from the cache itself, a miss adds
+* the new pipeline to it. VK_EXT_pipeline_creation_feedback would say so per
+* pipeline, but its struct goes in VkGraphicsPipelineCreateInfo's pNext chain and
+* dlu_create_graphics_pipelines() builds that one internally.
+*/
+typedef struct _pipe_cache {
+  char *path;
+  void *data; /* Blob from disk that matched the device, NULL when starting empty */
+  size_t size;
+  size_t before; /* Cache size when pipeline creation started */
+  double start;
+} pipe_cache;
+
+/* name tells examples apart, never fails: a missing or mismatched blob just means an empty cache */
+void pipe_cache_load(pipe_cache *pc, const char *name, const VkPhysicalDeviceProperties *props);
+
+/* Wrap pipeline creation in these two to log whether it came out of the cache and how long it took */
+void pipe_cache_begin(pipe_cache *pc, VkDevice device, VkPipelineCache cache);
+void pipe_cache_end(pipe_cache *pc, VkDevice device, VkPipelineCache cache);
+
+/* Writes the cache back if it differs from what was loaded, call before the device goes away */
+bool pipe_cache_save(pipe_cache *pc, VkDevice device, VkPipelineCache cache);
+void pipe_cache_fini(pipe_cache *pc);
+
+#endif
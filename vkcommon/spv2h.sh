@@ -0,0 +1,36 @@
+#!/bin/sh
+# Turns a SPIR-V binary into a header with the words in a static const array,
+# so the examples hand them straight to dlu_create_shader_module() without
+# reading (or allocating) anything at runtime.
+#
+# usage: spv2h.sh <in.spv> <array name> > out.h
+
+set -e
+
+[ $# -eq 2 ] || { echo "usage: $0 <in.spv> <array name>" >&2; exit 1; }
+
+# SPIR-V is a stream of 32 bit words, anything else is a broken compile
+size=$(wc -c < "$1")
+[ $((size % 4)) -eq 0 ] && [ "$size" -gt 0 ] || { echo "$0: $1 is not SPIR-V" >&2; exit 1; }
+
+guard=$(echo "$2" | tr 'a-z' 'A-Z')_H
+
+cat <<HDR
+/* Generated from $(basename "$1") by spv2h.sh, do not edit */
+#ifndef $guard
+#define $guard
+
+#include <stdint.h>
+
+/* vkCreateShaderModule() wants pCode 4 byte aligned */
+static const uint32_t $2[] __attribute__((aligned(4))) = {
+HDR
+
+# od reads host order words, which is what glslangValidator wrote
+od -An -v -tx4 "$1" | sed 's/ *\([0-9a-f]\{8\}\)/0x\1, /g; s/^/  /; s/, $/,/'
+
+cat <<FTR
+};
+
+#endif
+FTR
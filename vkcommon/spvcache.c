@@ -0,0 +1,190 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "cachefile.h"
+#include "spvcache.h"
+
+/* Set by the Makefile from pkg-config, a shaderc or lucurious update then misses */
+#ifndef SPV_CACHE_COMPILER
+#define SPV_CACHE_COMPILER "unknown"
+#endif
+
+#define SPV_CACHE_MAGIC 0x43565053 /* "SPVC" */
+#define SPV_CACHE_VERSION 1
+#define SPIRV_MAGIC 0x07230203
+
+typedef struct _spv_entry_header {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t key;
+  uint32_t stage;
+  uint32_t word_count;
+  uint64_t compile_ns; /* What shaderc took when the entry was written */
+} spv_entry_header;
+
+static struct {
+  pthread_mutex_t lock;
+  uint32_t hits, misses;
+  uint64_t saved_ns, spent_ns;
+} stats = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+}
+
+/* FNV-1a, the key only has to tell shaders apart, not resist anyone */
+static uint64_t fnv1a(uint64_t h, const void *data, size_t size) {
+  const unsigned char *p = data;
+  for (size_t i = 0; i < size; i++) {
+    h ^= p[i];
+    h *= UINT64_C(0x100000001b3);
+  }
+  return h;
+}
+
+static uint64_t spv_key(VkShaderStageFlagBits stage, const char *src, const char *entry) {
+  uint32_t st = stage;
+  uint64_t h = UINT64_C(0xcbf29ce484222325);
+
+  /* Terminators go in too, so "ab" + "c" can't collide with "a" + "bc" */
+  h = fnv1a(h, SPV_CACHE_COMPILER, sizeof(SPV_CACHE_COMPILER));
+  h = fnv1a(h, &st, sizeof(st));
+  h = fnv1a(h, entry, strlen(entry) + 1);
+  return fnv1a(h, src, strlen(src) + 1);
+}
+
+static void *load_entry(const char *path, uint64_t key, VkShaderStageFlagBits stage, size_t *byte_size, uint64_t *compile_ns) {
+  spv_entry_header hdr;
+  size_t size = 0;
+  char *data = cache_file_read(path, &size);
+  void *words = NULL;
+
+  if (!data) return NULL;
+  if (size < sizeof(hdr)) goto exit_load;
+  memcpy(&hdr, data, sizeof(hdr));
+
+  if (hdr.magic != SPV_CACHE_MAGIC || hdr.version != SPV_CACHE_VERSION) goto exit_load;
+  if (hdr.key != key || hdr.stage != (uint32_t) stage || !hdr.word_count) goto exit_load;
+  if (size != sizeof(hdr) + hdr.word_count * sizeof(uint32_t)) goto exit_load;
+
+  /* Own allocation so the words are 4 byte aligned, as vkCreateShaderModule wants */
+  words = malloc(size - sizeof(hdr));
+  if (!words) goto exit_load;
+  memcpy(words, data + sizeof(hdr), size - sizeof(hdr));
+
+  if (*(uint32_t *) words != SPIRV_MAGIC) { free(words); words = NULL; goto exit_load; }
+
+  *byte_size = size - sizeof(hdr);
+  *compile_ns = hdr.compile_ns;
+
+exit_load:
+  if (!words) dlu_log_me(DLU_WARNING, "SPIR-V cache: %s is stale or damaged, compiling", path);
+  free(data);
+  return words;
+}
+
+static void store_entry(const char *path, uint64_t key, VkShaderStageFlagBits stage, const void *bytes, size_t byte_size, uint64_t compile_ns) {
+  spv_entry_header hdr = {
+    .magic = SPV_CACHE_MAGIC, .version = SPV_CACHE_VERSION, .key = key,
+    .stage = stage, .word_count = byte_size / sizeof(uint32_t), .compile_ns = compile_ns
+  };
+
+  char *data = malloc(sizeof(hdr) + byte_size);
+  if (!data) return;
+
+  memcpy(data, &hdr, sizeof(hdr));
+  memcpy(data + sizeof(hdr), bytes, byte_size);
+  cache_file_write(path, data, sizeof(hdr) + byte_size);
+  free(data);
+}
+
+spv_shader spv_cache_compile(VkShaderStageFlagBits stage, const char *src, const char *name, const char *entry) {
+  spv_shader sh;
+  char file[64];
+  char *path = NULL;
+  uint64_t compile_ns = 0, start = now_ns();
+  uint64_t key = spv_key(stage, src, entry);
+
+  memset(&sh, 0, sizeof(sh));
+
+  snprintf(file, sizeof(file), "%016llx.spvcache", (unsigned long long) key);
+  path = cache_file_path(file);
+
+  if (path) sh.words = load_entry(path, key, stage, &sh.byte_size, &compile_ns);
+
+  if (sh.words) {
+    uint64_t took = now_ns() - start;
+    sh.hit = true;
+    sh.bytes = sh.words;
+
+    pthread_mutex_lock(&stats.lock);
+    stats.hits++;
+    if (compile_ns > took) stats.saved_ns += compile_ns - took;
+    pthread_mutex_unlock(&stats.lock);
+
+    dlu_log_me(DLU_INFO, "SPIR-V cache: hit for %s, %zu bytes in %.2f ms", name, sh.byte_size, took * 1e-6);
+    goto exit_compile;
+  }
+
+  sh.shi = dlu_compile_to_spirv(stage, (char *) src, (char *) name, (char *) entry);
+  if (!sh.shi.bytes) goto exit_compile;
+
+  compile_ns = now_ns() - start;
+  sh.bytes = (char *) sh.shi.bytes;
+  sh.byte_size = sh.shi.byte_size;
+
+  pthread_mutex_lock(&stats.lock);
+  stats.misses++;
+  stats.spent_ns += compile_ns;
+  pthread_mutex_unlock(&stats.lock);
+
+  dlu_log_me(DLU_INFO, "SPIR-V cache: miss for %s, shaderc took %.2f ms", name, compile_ns * 1e-6);
+  if (path) store_entry(path, key, stage, sh.bytes, sh.byte_size, compile_ns);
+
+exit_compile:
+  free(path);
+  return sh;
+}
+
+void spv_cache_release(spv_shader *sh) {
+  if (sh->hit) free(sh->words);
+  else if (sh->shi.bytes) dlu_freeup_spriv_bytes(DLU_LIB_SHADERC_SPRIV, sh->shi.result);
+  memset(sh, 0, sizeof(spv_shader));
+}
+
+void spv_cache_report(void) {
+  pthread_mutex_lock(&stats.lock);
+  dlu_log_me(DLU_SUCCESS, "SPIR-V cache: %u hit(s), %u miss(es), %.2f ms of shaderc saved, %.2f ms spent",
+             stats.hits, stats.misses, stats.saved_ns * 1e-6, stats.spent_ns * 1e-6);
+  pthread_mutex_unlock(&stats.lock);
+}
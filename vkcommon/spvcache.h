@@ -0,0 +1,60 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#ifndef SPVCACHE_H
+#define SPVCACHE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#define LUCUR_VKCOMP_API
+#define LUCUR_SPIRV_API
+#include <dluc/lucurious.h>
+
+/**
+* Keeps what libshaderc made of the embedded GLSL between runs. The entry is
+* keyed on a hash of the source, the stage, the entry point and the compiler
+* version, so touching any of them compiles again. A hit reads the stored
+* SPIR-V words back instead of starting shaderc, which is most of a cold start.
+*
+* Safe to call from several threads at once: the stats sit behind a lock and
+* entries are renamed into place, so two threads (or two processes) missing
+* on the same shader both compile and the last write wins.
+*/
+typedef struct _spv_shader {
+  char *bytes; /* Hand these to dlu_create_shader_module() */
+  size_t byte_size;
+  bool hit;
+  void *words; /* Cached words on a hit */
+  dlu_shader_info shi; /* shaderc output on a miss */
+} spv_shader;
+
+/* Same arguments as dlu_compile_to_spirv(), bytes is NULL when compilation failed */
+spv_shader spv_cache_compile(VkShaderStageFlagBits stage, const char *src, const char *name, const char *entry);
+void spv_cache_release(spv_shader *sh);
+
+/* Logs hits, misses and the shaderc time hits didn't have to spend */
+void spv_cache_report(void);
+
+#endif
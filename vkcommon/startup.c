@@ -0,0 +1,101 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LUCUR_VKCOMP_API
+#include <dluc/lucurious.h>
+
+#include "startup.h"
+
+static struct timespec origin;
+static bool serial, frame_seen;
+static startup_task *tasks;
+
+static double since_begin(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (ts.tv_sec - origin.tv_sec) * 1e3 + (ts.tv_nsec - origin.tv_nsec) * 1e-6;
+}
+
+void startup_begin(void) {
+  const char *env = getenv("LUCUR_STARTUP_SERIAL");
+
+  clock_gettime(CLOCK_MONOTONIC, &origin);
+  serial = env && *env && strcmp(env, "0");
+  frame_seen = false;
+}
+
+static void *task_thread(void *arg) {
+  startup_task *t = arg;
+
+  t->start = since_begin();
+  t->ok = t->run(t->arg);
+  t->end = since_begin();
+  return NULL;
+}
+
+void startup_spawn(startup_task *t, const char *name, startup_fn run, void *arg) {
+  memset(t, 0, sizeof(startup_task));
+  t->name = name; t->run = run; t->arg = arg;
+  t->next = tasks;
+  tasks = t;
+
+  if (!serial) {
+    t->threaded = !pthread_create(&t->thread, NULL, task_thread, t);
+    if (t->threaded) return;
+    dlu_log_me(DLU_WARNING, "Startup: no thread for %s, running it inline", name);
+  }
+
+  task_thread(t);
+}
+
+bool startup_join(startup_task *t) {
+  double wait = since_begin();
+
+  if (t->threaded) {
+    pthread_join(t->thread, NULL);
+    t->threaded = false;
+  }
+
+  wait = since_begin() - wait;
+  dlu_log_me(DLU_INFO, "Startup: %s ran %.2f -> %.2f ms, main waited %.2f ms for it", t->name, t->start, t->end, wait);
+  return t->ok;
+}
+
+void startup_join_all(void) {
+  for (startup_task *t = tasks; t; t = t->next) {
+    if (!t->threaded) continue;
+    pthread_join(t->thread, NULL);
+    t->threaded = false;
+  }
+}
+
+void startup_first_frame(void) {
+  if (frame_seen) return;
+  frame_seen = true;
+  dlu_log_me(DLU_SUCCESS, "Startup: first frame presented %.2f ms after start (%s)", since_begin(), (serial) ? "serial" : "parallel");
+}
@@ -0,0 +1,72 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#ifndef STARTUP_H
+#define STARTUP_H
+
+#include <stdbool.h>
+#include <pthread.h>
+
+/**
+* Startup work that doesn't depend on what main() is doing (the Wayland
+* handshake, shader compilation) runs on a thread of its own and is joined
+* right before the first step that needs its result, so the roundtrips and
+* shaderc overlap with instance and device creation instead of adding to them.
+*
+* LUCUR_STARTUP_SERIAL=1 runs every task inline where it's spawned, which is
+* the old serial startup, to compare time to first frame against.
+*/
+
+typedef bool (*startup_fn)(void *arg);
+
+typedef struct _startup_task {
+  const char *name;
+  startup_fn run;
+  void *arg;
+  pthread_t thread;
+  bool threaded; /* false when serial or the thread couldn't be created */
+  bool ok;
+  double start, end; /* ms since startup_begin() */
+  struct _startup_task *next; /* Every spawned task, for startup_join_all() */
+} startup_task;
+
+/* First thing in main(), every time reported is relative to it */
+void startup_begin(void);
+
+/* Never fails, a task that can't get a thread runs right away instead */
+void startup_spawn(startup_task *t, const char *name, startup_fn run, void *arg);
+
+/* Waits for the task and returns what it returned, logging how long main() was held up */
+bool startup_join(startup_task *t);
+
+/**
+* Waits for every task that is still running. Error paths call it before freeing
+* anything, a task may still be using wc or the allocator's blocks.
+*/
+void startup_join_all(void);
+
+/* Call after each present, only the first one is reported */
+void startup_first_frame(void);
+
+#endif